@@ -5,6 +5,7 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -135,6 +136,7 @@ print_stats (void)
 #endif
   console_print_stats ();
   kbd_print_stats ();
+  malloc_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
 #endif
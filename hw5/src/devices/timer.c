@@ -1,6 +1,7 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
@@ -24,18 +25,54 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Timer wheel.
+
+   Pending timers are kept in a hierarchical timer wheel, so that
+   adding, canceling, and expiring a timer each take constant time
+   however many timers are pending.  The wheel has WHEEL_LEVELS
+   levels of WHEEL_SLOTS slots, each slot a list of timers.
+
+   A timer that expires within WHEEL_SLOTS ticks goes in level 0,
+   in the slot for its expiry tick modulo WHEEL_SLOTS, and each
+   timer interrupt expires the timers in the slot for the current
+   tick.  A timer that expires later goes in a higher level, whose
+   slots each cover WHEEL_SLOTS times as many ticks as those of
+   the level below, in the slot for its expiry tick in those
+   units.  Each time a level wraps around, the timers in the
+   current slot of the level above are "cascaded" down by adding
+   them again, which puts them in a lower level now that they are
+   closer.  A timer that expires further off than the wheel spans
+   is put where it would go if it expired at the end of the span,
+   and keeps being cascaded at the top level until it comes in
+   range.
+
+   The wheel is accessed only with interrupts off. */
+#define WHEEL_BITS 6                    /* Log2 of slots per level. */
+#define WHEEL_SLOTS (1 << WHEEL_BITS)   /* Slots per level. */
+#define WHEEL_LEVELS 4                  /* Number of levels. */
+static struct list wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void wheel_insert (struct timer *);
+static void cascade (int level);
+static void run_timers (void);
+static timer_func wake_up;
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void)
 {
+  int level, slot;
+
   pit_configure_channel (0, 2, TIMER_FREQ);
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (slot = 0; slot < WHEEL_SLOTS; slot++)
+      list_init (&wheel[level][slot]);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -85,15 +122,73 @@ timer_elapsed (int64_t then)
 }
 
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.
+
+   The thread blocks until a timer wakes it, so that a sleeping
+   thread takes no CPU time. */
 void
 timer_sleep (int64_t ticks)
 {
-  int64_t start = timer_ticks ();
+  struct timer timer;
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks)
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  timer_setup (&timer, wake_up, thread_current ());
+  old_level = intr_disable ();
+  timer_add (&timer, ticks);
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* Initializes timer T to call FUNC with AUX when it expires. */
+void
+timer_setup (struct timer *t, timer_func *func, void *aux)
+{
+  ASSERT (t != NULL);
+  ASSERT (func != NULL);
+
+  t->func = func;
+  t->aux = aux;
+  t->pending = false;
+}
+
+/* Starts timer T, which must not be pending, so that it expires
+   TICKS timer ticks from now, or at the next tick if TICKS is
+   less than 1.  May be called from an interrupt handler,
+   including from a timer function. */
+void
+timer_add (struct timer *t, int64_t ticks)
+{
+  enum intr_level old_level;
+
+  ASSERT (!t->pending);
+
+  old_level = intr_disable ();
+  t->expires = timer_ticks () + (ticks > 0 ? ticks : 1);
+  t->pending = true;
+  wheel_insert (t);
+  intr_set_level (old_level);
+}
+
+/* Stops timer T before it expires.  Returns true if T was
+   pending, false if it had already expired or was never
+   added. */
+bool
+timer_cancel (struct timer *t)
+{
+  enum intr_level old_level = intr_disable ();
+  bool was_pending = t->pending;
+
+  if (was_pending)
+    {
+      list_remove (&t->elem);
+      t->pending = false;
+    }
+  intr_set_level (old_level);
+  return was_pending;
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -172,6 +267,75 @@ timer_interrupt (struct intr_frame *args UNUSED)
 {
   ticks++;
   thread_tick ();
+  run_timers ();
+}
+
+/* Puts pending timer T in the slot of the timer wheel where it
+   belongs, given the current tick. */
+static void
+wheel_insert (struct timer *t)
+{
+  int64_t span = (int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS);
+  int64_t expires = t->expires;
+  int level;
+
+  if (expires < ticks)
+    expires = ticks;
+  else if (expires - ticks >= span)
+    expires = ticks + span - 1;
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    if (expires - ticks < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
+      break;
+  list_push_back (&wheel[level][(expires >> (WHEEL_BITS * level))
+                                & (WHEEL_SLOTS - 1)],
+                  &t->elem);
+}
+
+/* Adds the timers in the current slot of the given LEVEL of the
+   timer wheel again, which moves them to lower levels. */
+static void
+cascade (int level)
+{
+  struct list *slot = &wheel[level][(ticks >> (WHEEL_BITS * level))
+                                    & (WHEEL_SLOTS - 1)];
+
+  while (!list_empty (slot))
+    wheel_insert (list_entry (list_pop_front (slot), struct timer, elem));
+}
+
+/* Cascades the levels of the timer wheel that are due, then
+   calls the functions of the timers that expire at this tick. */
+static void
+run_timers (void)
+{
+  struct list *slot;
+  int level;
+
+  for (level = 1; level < WHEEL_LEVELS; level++)
+    {
+      if (((ticks >> (WHEEL_BITS * (level - 1))) & (WHEEL_SLOTS - 1)) != 0)
+        break;
+      cascade (level);
+    }
+
+  /* A timer function may add timers, but never to this slot,
+     since they expire at a later tick. */
+  slot = &wheel[0][ticks & (WHEEL_SLOTS - 1)];
+  while (!list_empty (slot))
+    {
+      struct timer *t = list_entry (list_pop_front (slot), struct timer,
+                                    elem);
+      ASSERT (t->expires <= ticks);
+      t->pending = false;
+      t->func (t->aux);
+    }
+}
+
+/* Timer function for timer_sleep(): wakes up thread T. */
+static void
+wake_up (void *t)
+{
+  thread_unblock (t);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
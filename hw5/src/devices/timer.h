@@ -1,7 +1,9 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -24,6 +26,27 @@ void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* Function called when a timer expires.  It runs in the timer
+   interrupt handler, so it must not sleep. */
+typedef void timer_func (void *aux);
+
+/* A kernel timer, which calls a function once at a given tick.
+   Set up with timer_setup(); the members are private to
+   timer.c. */
+struct timer
+  {
+    struct list_elem elem;      /* Element in a timer wheel slot. */
+    int64_t expires;            /* Tick at which to call FUNC. */
+    timer_func *func;           /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* Added and not yet expired or canceled? */
+  };
+
+/* Kernel timers. */
+void timer_setup (struct timer *, timer_func *, void *aux);
+void timer_add (struct timer *, int64_t ticks);
+bool timer_cancel (struct timer *);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
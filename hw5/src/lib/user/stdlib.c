@@ -1,28 +1,1022 @@
 #include <stdlib.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <round.h>
+#include <stdio.h>
 #include <syscall.h>
 
+/* User-space malloc().
+
+   The heap is a single contiguous region obtained from the
+   kernel with sbrk().  It is carved into blocks, each of which
+   starts with a header and ends with a footer ("boundary
+   tags").  Both tags hold the size of the block in bytes, with
+   the low bit set if the block is allocated:
+
+        +--------+----------------------------------+--------+
+        | header |             payload              | footer |
+        +--------+----------------------------------+--------+
+
+   Free blocks keep links to other free blocks of similar size
+   at the start of their payload.  Free blocks are sorted into
+   segregated lists, one per power-of-2 size class, so a request
+   only examines blocks that are likely to fit.  A bitmap records
+   which classes are nonempty so the first usable class can be
+   found without walking empty lists.
+
+   When a block is freed, it is merged with any free neighbours,
+   which are found in constant time through the footer of the
+   preceding block and the header of the following one.  When no
+   free block is large enough, the heap is grown with sbrk() by
+   at least HEAP_CHUNK bytes at a time, so that most requests do
+   not need a system call at all.  Conversely, when the free block
+   at the end of the heap grows past the trim threshold, its
+   whole pages are handed back to the kernel with a negative
+   sbrk().
+
+   The heap begins with an allocated "prologue" block and ends
+   with an allocated, zero-size "epilogue" header, so merging
+   never has to check for the ends of the heap.
+
+   In front of the free lists sits a cache of recently freed
+   small blocks, one "magazine" per exact block size.  A cached
+   block stays marked allocated, so it is neither merged nor put
+   on a free list, and the next request for the same size takes
+   it back with a few instructions.  User processes have a single
+   thread, so the cache needs no locking.  Cached blocks are
+   released to the free lists before the heap is grown.
+
+   Requests of at least the large threshold skip the cache and
+   the small size classes.  They are rounded up to whole pages
+   and carved from a free block in one of the large classes, or
+   else from the end of the heap, and their blocks are marked as
+   "spans".  Freeing a span that ends up at the end of the heap
+   returns its pages to the kernel at once, whatever the trim
+   threshold, so a huge buffer does not linger in the heap after
+   it is freed.  (The kernel offers no way to map memory outside
+   the heap, so this is as close as we can get to giving large
+   blocks their own mappings.)
+
+   The kernel hands out zeroed pages, so memory that has never
+   been given to the program needs no zeroing in calloc().  The
+   heap keeps a "clean mark": every byte between it and the end
+   of the heap is zero, apart from the tags and free-list links
+   of the free blocks there.  Allocating a block raises the mark
+   past it; trimming the heap lowers the mark to the new end,
+   since the pages given back will come back zeroed; and tags and
+   links above the mark that end up inside a merged block are
+   cleared when the merge happens.  calloc() then only has to
+   clear a block's links if it comes from above the mark. */
+
+/* Size of a page, the unit in which the heap grows. */
+#define PAGE_SIZE 4096
+
+/* Minimum number of bytes by which to grow the heap. */
+#define HEAP_CHUNK (4 * PAGE_SIZE)
+
+/* Default for the M_TRIM_THRESHOLD parameter. */
+#define DEFAULT_TRIM_THRESHOLD (32 * PAGE_SIZE)
+
+/* Default for the M_LARGE_THRESHOLD parameter. */
+#define DEFAULT_LARGE_THRESHOLD (32 * PAGE_SIZE)
+
+/* Freeing a region at least this big flushes the cache, so that
+   cached blocks do not keep the end of the heap from being
+   trimmed. */
+#define CACHE_FLUSH_THRESHOLD (16 * PAGE_SIZE)
+
+/* Payload alignment. */
+#define ALIGNMENT 8
+
+/* Size of a header or footer. */
+#define TAG_SIZE sizeof (size_t)
+
+/* Bytes of tags in each block. */
+#define TAG_OVERHEAD (2 * TAG_SIZE)
+
+/* Tag bit that marks a block as allocated. */
+#define TAG_ALLOC 0x1
+
+/* Tag bit that marks an allocated block as a large span. */
+#define TAG_SPAN 0x2
+
+/* Tag bit that marks an allocated block as sitting in the cache.
+   Only kept in the header. */
+#define TAG_CACHED 0x4
+
+/* Tag bits that do not encode the size. */
+#define TAG_FLAGS (ALIGNMENT - 1)
+
+/* Number of segregated size classes.  Class K holds free blocks
+   of 2**(K + 4) to 2**(K + 5) - 1 bytes; the last class also
+   holds everything larger. */
+#define CLASS_CNT MALLOC_CLASS_CNT
+
+/* Largest block size kept in the cache. */
+#define CACHE_MAX_SIZE 256
+
+/* Number of blocks that one magazine holds. */
+#define MAGAZINE_DEPTH 16
+
+/* A block.  Only the header is always present; NEXT and PREV
+   are only meaningful while the block is free. */
+struct block
+  {
+    size_t header;              /* Block size | TAG_* flags. */
+    struct block *next;         /* Next free block in class. */
+    struct block *prev;         /* Previous free block in class. */
+  };
+
+/* Smallest block that can hold a free block's links and footer. */
+#define MIN_BLOCK ROUND_UP (sizeof (struct block) + TAG_SIZE, ALIGNMENT)
+
+/* A stack of freed blocks, all of the same size. */
+struct magazine
+  {
+    size_t cnt;                         /* Number of cached blocks. */
+    struct block *blocks[MAGAZINE_DEPTH]; /* Cached blocks. */
+  };
+
+/* Heap state. */
+static bool heap_initialized;           /* Has heap_init() run? */
+static uint8_t *heap_start;             /* Start of heap. */
+static uint8_t *heap_end;               /* Current break. */
+static uint8_t *clean_start;            /* Start of never-used memory. */
+static struct block *free_lists[CLASS_CNT]; /* Free blocks per class. */
+static uint32_t nonempty_classes;       /* Bit K set if class K nonempty. */
+static size_t trim_threshold = DEFAULT_TRIM_THRESHOLD;
+static size_t large_threshold = DEFAULT_LARGE_THRESHOLD;
+
+/* Large spans in use. */
+static size_t span_cnt;                 /* Number of spans. */
+static size_t span_bytes;               /* Total bytes in spans. */
+
+/* Statistics. */
+static size_t sbrk_calls;               /* Calls to sbrk(). */
+static size_t peak_heap_size;           /* Largest heap size so far. */
+
+/* Small block cache, indexed by block size / ALIGNMENT. */
+static struct magazine cache[CACHE_MAX_SIZE / ALIGNMENT + 1];
+static size_t cache_cnt;                /* Blocks in all magazines. */
+
+static bool heap_init (void);
+static struct block *extend_heap (size_t size);
+static struct block *find_fit (size_t size);
+static void *place (struct block *, size_t size);
+static struct block *coalesce (struct block *);
+static void *large_alloc (size_t size);
+static bool grow_in_place (struct block *, size_t size);
+static void shrink_in_place (struct block *, size_t size);
+static size_t release (struct block *, size_t trim_min);
+static void heap_trim (struct block *, size_t trim_min);
+static bool cache_flush (void);
+static void *heap_sbrk (intptr_t increment);
+
+/* Block helpers. */
+
+static inline size_t
+tag_size (size_t tag)
+{
+  return tag & ~(size_t) TAG_FLAGS;
+}
+
+static inline size_t
+block_size (const struct block *b)
+{
+  return tag_size (b->header);
+}
+
+static inline bool
+block_is_alloc (const struct block *b)
+{
+  return (b->header & TAG_ALLOC) != 0;
+}
+
+static inline bool
+block_is_span (const struct block *b)
+{
+  return (b->header & TAG_SPAN) != 0;
+}
+
+static inline bool
+block_is_cached (const struct block *b)
+{
+  return (b->header & TAG_CACHED) != 0;
+}
+
+/* Returns a pointer to B's footer. */
+static inline size_t *
+block_footer (struct block *b)
+{
+  return (size_t *) ((uint8_t *) b + block_size (b) - TAG_SIZE);
+}
+
+/* Sets B's header and footer to SIZE, keeping its flags. */
+static inline void
+block_resize (struct block *b, size_t size)
+{
+  b->header = size | (b->header & TAG_FLAGS);
+  *block_footer (b) = b->header;
+}
+
+/* Sets B's header and footer to SIZE, marked allocated if
+   ALLOC. */
+static inline void
+block_set (struct block *b, size_t size, bool alloc)
+{
+  b->header = size | (alloc ? TAG_ALLOC : 0);
+  *block_footer (b) = b->header;
+}
+
+static inline struct block *
+block_next (struct block *b)
+{
+  return (struct block *) ((uint8_t *) b + block_size (b));
+}
+
+/* Returns the block preceding B, found through its footer. */
+static inline struct block *
+block_prev (struct block *b)
+{
+  size_t prev_tag = *((size_t *) b - 1);
+  return (struct block *) ((uint8_t *) b - tag_size (prev_tag));
+}
+
+/* Called when block B is merged into the block before it.
+   Clears B's header and links and the preceding footer, which
+   are now inside the merged block, if they lie above the clean
+   mark. */
+static inline void
+scrub_boundary (struct block *b)
+{
+  if ((uint8_t *) (b + 1) > clean_start)
+    memset ((size_t *) b - 1, 0, TAG_SIZE + sizeof *b);
+}
+
+/* Records that allocated block B may be written by the
+   program. */
+static inline void
+mark_used (struct block *b)
+{
+  uint8_t *end = (uint8_t *) block_next (b);
+  if (end > clean_start)
+    clean_start = end;
+}
+
+/* Returns true if B is followed by nothing but free space. */
+static inline bool
+block_is_last (struct block *b)
+{
+  struct block *epilogue = (struct block *) (heap_end - TAG_SIZE);
+  struct block *next = block_next (b);
+
+  return next == epilogue
+         || (!block_is_alloc (next) && block_next (next) == epilogue);
+}
+
+/* Returns true if freeing B, a block for which block_is_last()
+   is true, would leave enough free space at the end of the heap
+   to trim. */
+static inline bool
+trim_due (struct block *b)
+{
+  return (size_t) (heap_end - (uint8_t *) b) >= trim_threshold + MIN_BLOCK
+                                                + PAGE_SIZE;
+}
+
+/* Returns the first block after the prologue. */
+static inline struct block *
+heap_first (void)
+{
+  return (struct block *) (ROUND_UP ((uintptr_t) heap_start, ALIGNMENT)
+                           + 3 * TAG_SIZE);
+}
+
+static inline void *
+block_to_payload (struct block *b)
+{
+  return (uint8_t *) b + TAG_SIZE;
+}
+
+static inline struct block *
+payload_to_block (void *p)
+{
+  return (struct block *) ((uint8_t *) p - TAG_SIZE);
+}
+
+/* Returns the block size needed to satisfy a SIZE-byte request,
+   or 0 if SIZE is so large that the computation overflows. */
+static inline size_t
+request_to_size (size_t size)
+{
+  if (size > SIZE_MAX - TAG_OVERHEAD - ALIGNMENT)
+    return 0;
+  size = ROUND_UP (size + TAG_OVERHEAD, ALIGNMENT);
+  return size < MIN_BLOCK ? MIN_BLOCK : size;
+}
+
+/* Free list helpers. */
+
+/* Returns the size class for a block of SIZE bytes. */
+static inline int
+size_to_class (size_t size)
+{
+  int cls = (int) (sizeof size * CHAR_BIT - 1) - __builtin_clzl (size) - 4;
+  return cls < CLASS_CNT ? cls : CLASS_CNT - 1;
+}
+
+static void
+free_list_insert (struct block *b)
+{
+  int cls = size_to_class (block_size (b));
+
+  b->prev = NULL;
+  b->next = free_lists[cls];
+  if (b->next != NULL)
+    b->next->prev = b;
+  free_lists[cls] = b;
+  nonempty_classes |= 1u << cls;
+}
+
+static void
+free_list_remove (struct block *b)
+{
+  int cls = size_to_class (block_size (b));
+
+  if (b->prev != NULL)
+    b->prev->next = b->next;
+  else
+    {
+      free_lists[cls] = b->next;
+      if (b->next == NULL)
+        nonempty_classes &= ~(1u << cls);
+    }
+  if (b->next != NULL)
+    b->next->prev = b->prev;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
 void*
 malloc (size_t size)
 {
-  /* Homework 5, Part B: YOUR CODE HERE */
-  
-  return sbrk(size);
+  struct block *b;
+  size_t asize;
+
+  /* A null pointer satisfies a request for 0 bytes. */
+  if (size == 0)
+    return NULL;
+
+  if (!heap_initialized && !heap_init ())
+    return NULL;
+
+  asize = request_to_size (size);
+  if (asize == 0)
+    return NULL;
+  if (asize >= large_threshold)
+    return large_alloc (asize);
+
+  /* Try the cache first. */
+  if (asize <= CACHE_MAX_SIZE)
+    {
+      struct magazine *m = &cache[asize / ALIGNMENT];
+      if (m->cnt > 0)
+        {
+          b = m->blocks[--m->cnt];
+          b->header &= ~TAG_CACHED;
+          cache_cnt--;
+          return block_to_payload (b);
+        }
+    }
+
+  b = find_fit (asize);
+  if (b == NULL && cache_flush ())
+    b = find_fit (asize);
+  if (b == NULL)
+    {
+      b = extend_heap (asize);
+      if (b == NULL)
+        return NULL;
+    }
+  return place (b, asize);
 }
 
-void free (void* ptr)
+/* Frees block PTR, which must have been previously allocated
+   with malloc(), calloc(), or realloc(). */
+void
+free (void* ptr)
 {
-  /* Homework 5, Part B: YOUR CODE HERE */
-  
+  struct block *b;
+  size_t size;
+
+  if (ptr == NULL)
+    return;
+
+  b = payload_to_block (ptr);
+  size = block_size (b);
+
+  /* Spans give their pages back as soon as they can. */
+  if (block_is_span (b))
+    {
+      span_cnt--;
+      span_bytes -= size;
+      release (b, 0);
+      return;
+    }
+
+  /* Keep small blocks in the cache while there is room, unless
+     freeing the block would let the heap be trimmed. */
+  if (size <= CACHE_MAX_SIZE && !(block_is_last (b) && trim_due (b)))
+    {
+      struct magazine *m = &cache[size / ALIGNMENT];
+      if (m->cnt < MAGAZINE_DEPTH)
+        {
+          b->header |= TAG_CACHED;
+          m->blocks[m->cnt++] = b;
+          cache_cnt++;
+          return;
+        }
+    }
+
+  if (release (b, trim_threshold) >= CACHE_FLUSH_THRESHOLD && cache_cnt > 0)
+    cache_flush ();
+}
+
+/* Allocates and return NMEMB times SIZE bytes initialized to
+   zeroes.  Returns a null pointer if memory is not available. */
+void*
+calloc (size_t nmemb, size_t size)
+{
+  uint8_t *clean;
+  uint8_t *p;
+  size_t total;
+
+  /* Calculate block size and make sure it fits in size_t. */
+  if (size != 0 && nmemb > SIZE_MAX / size)
+    return NULL;
+  total = nmemb * size;
+
+  if (!heap_initialized && !heap_init ())
+    return NULL;
+
+  /* Allocate and zero memory.  A block from above the clean mark
+     only holds the links it had while it was free. */
+  clean = clean_start;
+  p = malloc (total);
+  if (p != NULL)
+    {
+      if (p < clean)
+        memset (p, 0, total);
+      else
+        memset (p, 0, sizeof (struct block) - TAG_SIZE);
+    }
+
+  return p;
+}
+
+/* Attempts to resize PTR to SIZE bytes, possibly moving it in
+   the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer and leaves PTR untouched.
+   A call with null PTR is equivalent to malloc(SIZE).
+   A call with zero SIZE is equivalent to free(PTR).
+
+   The block is resized in place whenever possible: shrinking
+   splits off the tail, and growing absorbs a free block that
+   follows or, for the last block in the heap, extends the heap.
+   Only otherwise are the contents copied to a new block. */
+void*
+realloc (void* ptr, size_t size)
+{
+  struct block *b;
+  size_t old_size, asize;
+  void *new_ptr;
+
+  if (ptr == NULL)
+    return malloc (size);
+  if (size == 0)
+    {
+      free (ptr);
+      return NULL;
+    }
+
+  b = payload_to_block (ptr);
+  old_size = block_size (b);
+  asize = request_to_size (size);
+  if (asize == 0)
+    return NULL;
+  if (block_is_span (b))
+    {
+      if (asize > SIZE_MAX - PAGE_SIZE)
+        return NULL;
+      asize = ROUND_UP (asize, PAGE_SIZE);
+    }
+
+  if (asize <= old_size || grow_in_place (b, asize))
+    {
+      shrink_in_place (b, asize);
+      return ptr;
+    }
+
+  new_ptr = malloc (size);
+  if (new_ptr != NULL)
+    {
+      memcpy (new_ptr, ptr, old_size - TAG_OVERHEAD);
+      free (ptr);
+    }
+  return new_ptr;
+}
+
+/* Sets allocator parameter PARAM to VALUE.  Returns 1 if
+   successful, 0 if PARAM is unknown or VALUE is out of range. */
+int
+mallopt (int param, int value)
+{
+  if (value < 0)
+    return 0;
+
+  switch (param)
+    {
+    case M_TRIM_THRESHOLD:
+      trim_threshold = value;
+      return 1;
+
+    case M_LARGE_THRESHOLD:
+      large_threshold = value;
+      return 1;
+
+    default:
+      return 0;
+    }
 }
 
-void* calloc (size_t nmemb, size_t size)
+/* Stores statistics about the heap into *STATS. */
+void
+malloc_get_stats (struct malloc_stats *stats)
 {
-  /* Homework 5, Part B: YOUR CODE HERE */
-  return NULL;
+  struct block *b;
+  size_t i;
+
+  memset (stats, 0, sizeof *stats);
+  stats->sbrk_calls = sbrk_calls;
+  stats->peak_heap_size = peak_heap_size;
+  stats->span_cnt = span_cnt;
+  stats->span_bytes = span_bytes;
+  if (!heap_initialized)
+    return;
+
+  stats->heap_size = heap_end - heap_start;
+  for (i = 0; i < CLASS_CNT; i++)
+    for (b = free_lists[i]; b != NULL; b = b->next)
+      {
+        size_t size = block_size (b);
+
+        stats->free_blocks++;
+        stats->free_bytes += size;
+        stats->class_free_bytes[i] += size;
+        if (size > stats->largest_free)
+          stats->largest_free = size;
+      }
+  for (i = 0; i < sizeof cache / sizeof *cache; i++)
+    stats->cached_bytes += cache[i].cnt * i * ALIGNMENT;
+
+  /* Every other block is in use. */
+  stats->in_use_bytes = (heap_end - TAG_SIZE - (uint8_t *) heap_first ())
+                        - stats->free_bytes - stats->cached_bytes;
+  if (stats->free_bytes > 0)
+    stats->fragmentation = 100 - (uint64_t) stats->largest_free * 100
+                                 / stats->free_bytes;
+}
+
+/* Prints the heap statistics. */
+void
+malloc_print_stats (void)
+{
+  struct malloc_stats stats;
+  int i;
+
+  malloc_get_stats (&stats);
+  printf ("malloc: heap %zu bytes (peak %zu) from %zu sbrk calls\n",
+          stats.heap_size, stats.peak_heap_size, stats.sbrk_calls);
+  printf ("malloc: %zu bytes in use, %zu cached, %zu in %zu spans\n",
+          stats.in_use_bytes, stats.cached_bytes, stats.span_bytes,
+          stats.span_cnt);
+  printf ("malloc: %zu bytes free in %zu blocks, largest %zu, "
+          "%u%% fragmented\n", stats.free_bytes, stats.free_blocks,
+          stats.largest_free, stats.fragmentation);
+  for (i = 0; i < CLASS_CNT; i++)
+    if (stats.class_free_bytes[i] > 0)
+      printf ("malloc:   class %2d (%8zu+ bytes): %zu bytes free\n",
+              i, (size_t) 16 << i, stats.class_free_bytes[i]);
+}
+
+/* Walks the heap, checking that it is well formed.  If VERBOSE,
+   prints every block along the way.  Problems are always
+   printed.  Returns true if the heap is consistent, false
+   otherwise. */
+bool
+malloc_check_heap (bool verbose)
+{
+  struct block *epilogue, *b;
+  bool prev_free = false;
+  size_t free_cnt = 0;
+  size_t i;
+
+  if (!heap_initialized)
+    return true;
+
+  epilogue = (struct block *) (heap_end - TAG_SIZE);
+  for (b = heap_first (); b != epilogue; b = block_next (b))
+    {
+      size_t footer;
+
+      /* Check that the block lies within the heap before reading
+         its footer, which a corrupt size could put anywhere. */
+      if ((uint8_t *) b < heap_start || (uint8_t *) b >= (uint8_t *) epilogue
+          || block_size (b) < TAG_OVERHEAD
+          || block_size (b) > (size_t) ((uint8_t *) epilogue - (uint8_t *) b))
+        {
+          printf ("malloc: block %p runs outside the heap\n", (void *) b);
+          return false;
+        }
+
+      if (verbose)
+        printf ("malloc: %p %8zu %s%s%s\n", block_to_payload (b),
+                block_size (b), block_is_alloc (b) ? "in use" : "free",
+                block_is_span (b) ? ", span" : "",
+                block_is_cached (b) ? ", cached" : "");
+
+      footer = *block_footer (b);
+      if (tag_size (footer) != block_size (b)
+          || (footer & TAG_ALLOC) != (b->header & TAG_ALLOC))
+        {
+          printf ("malloc: block %p has mismatched tags\n", (void *) b);
+          return false;
+        }
+      if (!block_is_alloc (b))
+        {
+          if (prev_free)
+            {
+              printf ("malloc: block %p was not merged\n", (void *) b);
+              return false;
+            }
+          free_cnt++;
+        }
+      prev_free = !block_is_alloc (b);
+    }
+
+  for (i = 0; i < CLASS_CNT; i++)
+    for (b = free_lists[i]; b != NULL; b = b->next)
+      {
+        if ((uint8_t *) b < heap_start || (uint8_t *) b >= (uint8_t *) epilogue
+            || block_is_alloc (b)
+            || size_to_class (block_size (b)) != (int) i)
+          {
+            printf ("malloc: block %p is on the wrong free list\n",
+                    (void *) b);
+            return false;
+          }
+        free_cnt--;
+      }
+  if (free_cnt != 0)
+    {
+      printf ("malloc: free lists do not match the heap\n");
+      return false;
+    }
+  return true;
+}
+
+/* Sets up an empty heap at the current break.
+   Returns true if successful, false on failure. */
+static bool
+heap_init (void)
+{
+  uint8_t *brk = heap_sbrk (0);
+  uint8_t *start = (uint8_t *) ROUND_UP ((uintptr_t) brk, ALIGNMENT);
+  size_t *prologue;
+
+  /* Round the break up to a page boundary, leaving room for the
+     padding word, the prologue and the epilogue. */
+  size_t increment = ROUND_UP ((uintptr_t) start + 4 * TAG_SIZE, PAGE_SIZE)
+                     - (uintptr_t) brk;
+  if (heap_sbrk (increment) == (void *) -1)
+    return false;
+  heap_start = brk;
+  heap_end = brk + increment;
+  peak_heap_size = heap_end - heap_start;
+
+  /* Only the pages above the old break are known to be zero. */
+  clean_start = (uint8_t *) ROUND_UP ((uintptr_t) brk, PAGE_SIZE);
+
+  /* Word 0 is padding so that payloads are aligned; words 1 and
+     2 are the prologue's header and footer. */
+  prologue = (size_t *) start + 1;
+  prologue[0] = prologue[1] = TAG_OVERHEAD | TAG_ALLOC;
+
+  /* Everything between the prologue and the epilogue is one
+     free block, unless the break was already close to a page
+     boundary. */
+  struct block *b = heap_first ();
+  size_t size = heap_end - TAG_SIZE - (uint8_t *) b;
+  if (size >= MIN_BLOCK)
+    {
+      block_set (b, size, false);
+      free_list_insert (b);
+    }
+  else if (size > 0)
+    block_set (b, size, true);
+  ((struct block *) (heap_end - TAG_SIZE))->header = TAG_ALLOC;
+
+  heap_initialized = true;
+  return true;
+}
+
+/* Grows the heap so that a free block of at least SIZE bytes
+   sits at its end, removes that block from its free list, and
+   returns it.  Returns a null pointer if the kernel refuses to
+   grow the heap or if someone else has moved the break. */
+static struct block *
+extend_heap (size_t size)
+{
+  struct block *epilogue = (struct block *) (heap_end - TAG_SIZE);
+  struct block *last = block_prev (epilogue);
+  size_t increment;
+  uint8_t *brk;
+  struct block *b;
+
+  /* A free block at the end of the heap only needs to be topped
+     up. */
+  if (!block_is_alloc (last))
+    size -= block_size (last);
+
+  if (size > SIZE_MAX - HEAP_CHUNK - PAGE_SIZE)
+    return NULL;
+  increment = ROUND_UP (size > HEAP_CHUNK ? size : HEAP_CHUNK, PAGE_SIZE);
+  if ((intptr_t) increment < 0)
+    return NULL;
+  brk = heap_sbrk (increment);
+  if (brk == (void *) -1)
+    return NULL;
+  if (brk != heap_end)
+    {
+      /* The program moved the break itself.  We cannot merge
+         the new memory into the heap, so give it back. */
+      heap_sbrk (-(intptr_t) increment);
+      return NULL;
+    }
+  heap_end += increment;
+  if ((size_t) (heap_end - heap_start) > peak_heap_size)
+    peak_heap_size = heap_end - heap_start;
+
+  /* The old epilogue becomes the header of the new free
+     block. */
+  b = epilogue;
+  block_set (b, increment, false);
+  ((struct block *) (heap_end - TAG_SIZE))->header = TAG_ALLOC;
+
+  return coalesce (b);
+}
+
+/* Returns a free block of at least SIZE bytes, removed from its
+   free list, or a null pointer if there is none. */
+static struct block *
+find_fit (size_t size)
+{
+  int cls = size_to_class (size);
+  uint32_t larger;
+  struct block *b;
+
+  /* Blocks in SIZE's own class may be too small. */
+  for (b = free_lists[cls]; b != NULL; b = b->next)
+    if (block_size (b) >= size)
+      {
+        free_list_remove (b);
+        return b;
+      }
+
+  /* Any block in a larger class fits. */
+  larger = cls + 1 < CLASS_CNT ? nonempty_classes & -(2u << cls) : 0;
+  if (larger == 0)
+    return NULL;
+  b = free_lists[__builtin_ctz (larger)];
+  free_list_remove (b);
+  return b;
+}
+
+/* Marks the first SIZE bytes of free block B, which is not on
+   any free list, as allocated, and returns its payload.  Puts
+   any sufficiently large remainder back on a free list. */
+static void *
+place (struct block *b, size_t size)
+{
+  size_t remainder = block_size (b) - size;
+
+  if (remainder >= MIN_BLOCK)
+    {
+      struct block *rest;
+
+      block_set (b, size, true);
+      rest = block_next (b);
+      block_set (rest, remainder, false);
+      free_list_insert (rest);
+    }
+  else
+    block_set (b, block_size (b), true);
+
+  mark_used (b);
+  return block_to_payload (b);
+}
+
+/* Merges free block B, which is not on any free list, with its
+   free neighbours, removing them from their free lists.
+   Returns the merged block, which is not on any free list. */
+static struct block *
+coalesce (struct block *b)
+{
+  struct block *prev = block_prev (b);
+  struct block *next = block_next (b);
+  size_t size = block_size (b);
+
+  if (!block_is_alloc (next))
+    {
+      free_list_remove (next);
+      size += block_size (next);
+      scrub_boundary (next);
+    }
+  if (!block_is_alloc (prev))
+    {
+      free_list_remove (prev);
+      size += block_size (prev);
+      scrub_boundary (b);
+      b = prev;
+    }
+  block_set (b, size, false);
+  return b;
+}
+
+/* Allocates a large span of at least SIZE bytes and returns its
+   payload, or a null pointer if memory is not available. */
+static void *
+large_alloc (size_t size)
+{
+  struct block *b;
+  void *p;
+
+  if (size > SIZE_MAX - PAGE_SIZE)
+    return NULL;
+  size = ROUND_UP (size, PAGE_SIZE);
+
+  /* Only the large classes can satisfy SIZE, so find_fit() does
+     not look at any small block. */
+  b = find_fit (size);
+  if (b == NULL)
+    {
+      b = extend_heap (size);
+      if (b == NULL)
+        return NULL;
+    }
+  p = place (b, size);
+
+  b->header |= TAG_SPAN;
+  *block_footer (b) = b->header;
+  span_cnt++;
+  span_bytes += block_size (b);
+  return p;
+}
+
+/* Tries to grow allocated block B to at least SIZE bytes
+   without moving it, by absorbing the free block that follows it
+   or, if B is at the end of the heap, by extending the heap.
+   Returns true if successful, false otherwise. */
+static bool
+grow_in_place (struct block *b, size_t size)
+{
+  struct block *next = block_next (b);
+  size_t old_size = block_size (b);
+  size_t avail = old_size;
+
+  if (!block_is_alloc (next))
+    avail += block_size (next);
+
+  if (avail >= size)
+    {
+      /* B alone is too small, so NEXT must be free. */
+      free_list_remove (next);
+    }
+  else if (block_is_last (b))
+    {
+      /* extend_heap() merges any free block at the end of the
+         heap into the one it returns, which then directly
+         follows B. */
+      next = extend_heap (size - old_size);
+      if (next == NULL)
+        return false;
+      avail = old_size + block_size (next);
+    }
+  else
+    return false;
+
+  block_resize (b, avail);
+  mark_used (b);
+  if (block_is_span (b))
+    span_bytes += avail - old_size;
+  return true;
+}
+
+/* Shrinks allocated block B to SIZE bytes, if that leaves a
+   remainder big enough to be a block of its own, and releases
+   the remainder. */
+static void
+shrink_in_place (struct block *b, size_t size)
+{
+  size_t old_size = block_size (b);
+  struct block *rest;
+
+  if (old_size - size < MIN_BLOCK)
+    return;
+
+  block_resize (b, size);
+  rest = block_next (b);
+  block_set (rest, old_size - size, true);
+  if (block_is_span (b))
+    {
+      span_bytes -= old_size - size;
+      release (rest, 0);
+    }
+  else
+    release (rest, trim_threshold);
+}
+
+/* Marks allocated block B free, merges it with its neighbours,
+   and puts the result on a free list.  If the result ends up at
+   the end of the heap, trims the heap if that releases at least
+   TRIM_MIN bytes.  Returns the size of the merged block before
+   trimming. */
+static size_t
+release (struct block *b, size_t trim_min)
+{
+  size_t size;
+
+  block_set (b, block_size (b), false);
+  b = coalesce (b);
+  size = block_size (b);
+  if (block_next (b) == (struct block *) (heap_end - TAG_SIZE))
+    heap_trim (b, trim_min);
+  free_list_insert (b);
+  return size;
+}
+
+/* Gives the whole pages of free block B, the last block in the
+   heap, back to the kernel if there are at least TRIM_MIN bytes
+   of them.  B, which is not on any free list, keeps at least
+   MIN_BLOCK bytes. */
+static void
+heap_trim (struct block *b, size_t trim_min)
+{
+  uint8_t *new_end = (uint8_t *) ROUND_UP ((uintptr_t) b + MIN_BLOCK
+                                           + TAG_SIZE, PAGE_SIZE);
+  size_t excess;
+
+  if (new_end >= heap_end)
+    return;
+  excess = heap_end - new_end;
+  if (excess < trim_min || heap_sbrk (-(intptr_t) excess) == (void *) -1)
+    return;
+
+  heap_end = new_end;
+  if (clean_start > heap_end)
+    clean_start = heap_end;
+  block_set (b, heap_end - TAG_SIZE - (uint8_t *) b, false);
+  ((struct block *) (heap_end - TAG_SIZE))->header = TAG_ALLOC;
+}
+
+/* Returns every cached block to the free lists, so that it can
+   be merged with its neighbours.  Returns true if any block was
+   released, false if the cache was empty. */
+static bool
+cache_flush (void)
+{
+  size_t i;
+
+  if (cache_cnt == 0)
+    return false;
+
+  for (i = 0; i < sizeof cache / sizeof *cache; i++)
+    {
+      struct magazine *m = &cache[i];
+      while (m->cnt > 0)
+        release (m->blocks[--m->cnt], trim_threshold);
+    }
+  cache_cnt = 0;
+  return true;
 }
 
-void* realloc (void* ptr, size_t size)
+/* Calls sbrk() with INCREMENT, counting the call. */
+static void *
+heap_sbrk (intptr_t increment)
 {
-  /* Homework 5, Part B: YOUR CODE HERE */
-  return NULL;
+  sbrk_calls++;
+  return sbrk (increment);
 }
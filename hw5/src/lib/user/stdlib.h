@@ -1,9 +1,44 @@
 #ifndef __LIB_USER_STDLIB_H
 #define __LIB_USER_STDLIB_H
 
+#include <stdbool.h>
+
 void* malloc (size_t size);
 void free (void* ptr);
 void* calloc (size_t nmemb, size_t size);
 void* realloc (void* ptr, size_t size);
 
+/* Parameters for mallopt(). */
+#define M_TRIM_THRESHOLD 1      /* Free bytes at the end of the heap
+                                   that make free() shrink it. */
+#define M_LARGE_THRESHOLD 2     /* Smallest request served as a
+                                   page-granular span. */
+int mallopt (int param, int value);
+
+/* Number of size classes reported by malloc_get_stats(). */
+#define MALLOC_CLASS_CNT 26
+
+/* Heap statistics.  Class K covers free blocks of 2**(K + 4)
+   bytes and up. */
+struct malloc_stats
+  {
+    size_t heap_size;           /* Current heap size in bytes. */
+    size_t peak_heap_size;      /* Largest heap size so far. */
+    size_t sbrk_calls;          /* Number of sbrk() calls made. */
+    size_t in_use_bytes;        /* Bytes in blocks in use, with tags. */
+    size_t cached_bytes;        /* Bytes in freed blocks kept in cache. */
+    size_t span_cnt;            /* Large spans in use. */
+    size_t span_bytes;          /* Bytes in large spans in use. */
+    size_t free_blocks;         /* Number of free blocks. */
+    size_t free_bytes;          /* Bytes in free blocks. */
+    size_t largest_free;        /* Size of the largest free block. */
+    unsigned fragmentation;     /* Percent of free bytes outside the
+                                   largest free block. */
+    size_t class_free_bytes[MALLOC_CLASS_CNT]; /* Free bytes per class. */
+  };
+
+void malloc_get_stats (struct malloc_stats *);
+void malloc_print_stats (void);
+bool malloc_check_heap (bool verbose);
+
 #endif /* lib/user/stdlib.h */
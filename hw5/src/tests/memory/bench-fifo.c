@@ -0,0 +1,63 @@
+/* Allocator benchmark: producer/consumer lifetimes.
+   Messages of a few fixed sizes are produced in bursts and
+   consumed in arrival order, so every block lives for roughly
+   the same number of operations and is freed in FIFO order. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/memory/bench.h"
+
+#define NUM_ROUNDS 4000
+#define QUEUE_SIZE 256
+#define MAX_BURST 32
+
+static const size_t sizes[] = {24, 64, 100, 512};
+#define NUM_SIZES (sizeof sizes / sizeof *sizes)
+
+int
+main (int argc UNUSED, char *argv[] UNUSED)
+{
+  static char* queue[QUEUE_SIZE];
+  size_t head = 0, tail = 0, used = 0;
+  unsigned long ops = 0;
+
+  test_name = "bench-fifo";
+  msg ("begin");
+  bench_begin ();
+
+  for (int i = 0; i != NUM_ROUNDS; i++) {
+    /* Producer. */
+    size_t burst = 1 + bench_random (MAX_BURST);
+    for (size_t j = 0; j != burst && used != QUEUE_SIZE; j++) {
+      size_t size = sizes[bench_random (NUM_SIZES)];
+      char* p = malloc(size);
+      if (p == NULL)
+        fail ("malloc(%zu) failed", size);
+      memset(p, (int) size, size);
+      queue[tail] = p;
+      tail = (tail + 1) % QUEUE_SIZE;
+      used++;
+      ops++;
+    }
+
+    /* Consumer. */
+    burst = 1 + bench_random (MAX_BURST);
+    for (size_t j = 0; j != burst && used != 0; j++) {
+      free(queue[head]);
+      head = (head + 1) % QUEUE_SIZE;
+      used--;
+      ops++;
+    }
+  }
+  while (used != 0) {
+    free(queue[head]);
+    head = (head + 1) % QUEUE_SIZE;
+    used--;
+    ops++;
+  }
+
+  bench_end (ops);
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,50 @@
+/* Allocator benchmark: fragmentation stress.
+   Fills the heap with small blocks, frees every other one, and
+   then asks for blocks too big for any of the holes.  Repeats
+   with growing sizes, so a poor allocator keeps growing the heap
+   while the holes go unused. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/memory/bench.h"
+
+#define NUM_BLOCKS 2048
+#define NUM_PASSES 8
+
+int
+main (int argc UNUSED, char *argv[] UNUSED)
+{
+  static char* blocks[NUM_BLOCKS];
+  unsigned long ops = 0;
+
+  test_name = "bench-frag";
+  msg ("begin");
+  bench_begin ();
+
+  for (int pass = 0; pass != NUM_PASSES; pass++) {
+    size_t small = 16 + 16 * pass;
+
+    for (int i = 0; i != NUM_BLOCKS; i++) {
+      blocks[i] = malloc(small);
+      if (blocks[i] == NULL)
+        fail ("malloc(%zu) failed", small);
+      ops++;
+    }
+    for (int i = 0; i < NUM_BLOCKS; i += 2) {
+      free(blocks[i]);
+      blocks[i] = malloc(2 * small + bench_random (small));
+      if (blocks[i] == NULL)
+        fail ("malloc failed");
+      ops += 2;
+    }
+    for (int i = 0; i != NUM_BLOCKS; i++) {
+      free(blocks[i]);
+      ops++;
+    }
+  }
+
+  bench_end (ops);
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,48 @@
+/* Allocator benchmark: short-lived fixed-size blocks.
+   Blocks of a few small sizes are allocated and freed again
+   right away, singly or in small batches, which is the pattern
+   the per-size block cache in front of malloc() is meant to
+   make cheap. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/memory/bench.h"
+
+#define NUM_ROUNDS 20000
+#define MAX_BATCH 8
+
+static const size_t sizes[] = {16, 32, 48, 64, 128, 256};
+#define NUM_SIZES (sizeof sizes / sizeof *sizes)
+
+int
+main (int argc UNUSED, char *argv[] UNUSED)
+{
+  char* batch[MAX_BATCH];
+  unsigned long ops = 0;
+
+  test_name = "bench-pairs";
+  msg ("begin");
+  bench_begin ();
+
+  for (int i = 0; i != NUM_ROUNDS; i++) {
+    size_t size = sizes[bench_random (NUM_SIZES)];
+    size_t cnt = 1 + bench_random (MAX_BATCH);
+
+    for (size_t j = 0; j != cnt; j++) {
+      batch[j] = malloc(size);
+      if (batch[j] == NULL)
+        fail ("malloc(%zu) failed", size);
+      batch[j][0] = (char) j;
+      ops++;
+    }
+    while (cnt != 0) {
+      free(batch[--cnt]);
+      ops++;
+    }
+  }
+
+  bench_end (ops);
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,58 @@
+/* Allocator benchmark: random sizes with random lifetimes.
+   Most requests are small, some are a few kB, and a few are big
+   enough to be large spans. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/memory/bench.h"
+
+#define NUM_OPS 100000
+#define NUM_SLOTS 512
+
+static size_t
+random_size (void)
+{
+  size_t kind = bench_random (100);
+  if (kind < 80)
+    return 1 + bench_random (256);
+  else if (kind < 99)
+    return 1 + bench_random (4096);
+  else
+    return 1 + bench_random (256 * 1024);
+}
+
+int
+main (int argc UNUSED, char *argv[] UNUSED)
+{
+  static char* slots[NUM_SLOTS];
+  unsigned long ops = 0;
+
+  test_name = "bench-random";
+  msg ("begin");
+  bench_begin ();
+
+  for (int i = 0; i != NUM_OPS; i++) {
+    size_t slot = bench_random (NUM_SLOTS);
+    if (slots[slot] != NULL) {
+      free(slots[slot]);
+      slots[slot] = NULL;
+    } else {
+      size_t size = random_size ();
+      slots[slot] = malloc(size);
+      if (slots[slot] == NULL)
+        fail ("malloc(%zu) failed", size);
+      slots[slot][0] = slots[slot][size - 1] = 1;
+    }
+    ops++;
+  }
+  for (int i = 0; i != NUM_SLOTS; i++)
+    if (slots[i] != NULL) {
+      free(slots[i]);
+      ops++;
+    }
+
+  bench_end (ops);
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,54 @@
+/* Allocator benchmark: growing buffers.
+   Several buffers grow one small append at a time, the way a
+   string builder or a line reader does, while other buffers are
+   allocated and freed around them. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/memory/bench.h"
+
+#define NUM_BUFFERS 8
+#define NUM_APPENDS 4000
+#define MAX_APPEND 64
+
+struct buffer
+  {
+    char* data;
+    size_t size;
+  };
+
+int
+main (int argc UNUSED, char *argv[] UNUSED)
+{
+  static struct buffer buffers[NUM_BUFFERS];
+  unsigned long ops = 0;
+
+  test_name = "bench-realloc";
+  msg ("begin");
+  bench_begin ();
+
+  for (int i = 0; i != NUM_APPENDS; i++) {
+    struct buffer* b = &buffers[bench_random (NUM_BUFFERS)];
+    size_t append = 1 + bench_random (MAX_APPEND);
+    char* data = realloc(b->data, b->size + append);
+    if (data == NULL)
+      fail ("realloc to %zu bytes failed", b->size + append);
+    memset(data + b->size, (int) append, append);
+    b->data = data;
+    b->size += append;
+    ops++;
+
+    /* Some unrelated short-lived garbage. */
+    free(malloc(1 + bench_random (128)));
+    ops += 2;
+  }
+  for (int i = 0; i != NUM_BUFFERS; i++) {
+    free(buffers[i].data);
+    ops++;
+  }
+
+  bench_end (ops);
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,4 @@
+# -*- perl -*-
+use tests::tests;
+use tests::memory::bench;
+check_bench;
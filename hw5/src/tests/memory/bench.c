@@ -0,0 +1,56 @@
+/* Shared driver for the allocator benchmarks.
+
+   Each benchmark replays an allocation trace and then calls
+   bench_end(), which checks the heap and reports the number of
+   operations performed along with the heap's footprint.
+   bench.pm turns the operation count into operations per timer
+   tick using the tick counts the kernel prints at shutdown. */
+
+#include "tests/memory/bench.h"
+#include <random.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define PAGE_SIZE 4096
+
+/* Break before the benchmark started. */
+static uint8_t *start_brk;
+
+/* Records the initial break and seeds the random number
+   generator, so that every run replays the same trace. */
+void
+bench_begin (void)
+{
+  start_brk = sbrk (0);
+  random_init (0x162);
+}
+
+/* Returns a pseudo-random number between 0 and LIMIT - 1. */
+size_t
+bench_random (size_t limit)
+{
+  return random_ulong () % limit;
+}
+
+/* Checks the heap and reports OPS along with the peak and final
+   heap size in pages. */
+void
+bench_end (unsigned long ops)
+{
+  struct malloc_stats stats;
+
+  if (!malloc_check_heap (false))
+    fail ("heap is corrupt");
+  malloc_get_stats (&stats);
+
+  msg ("ops: %lu", ops);
+  msg ("peak heap pages: %zu",
+       DIV_ROUND_UP (stats.peak_heap_size, PAGE_SIZE));
+  msg ("final heap pages: %zu",
+       DIV_ROUND_UP ((size_t) ((uint8_t *) sbrk (0) - start_brk), PAGE_SIZE));
+  msg ("sbrk calls: %zu", stats.sbrk_calls);
+  msg ("fragmentation: %u%%", stats.fragmentation);
+}
@@ -0,0 +1,10 @@
+#ifndef TESTS_MEMORY_BENCH_H
+#define TESTS_MEMORY_BENCH_H
+
+#include <stddef.h>
+
+void bench_begin (void);
+size_t bench_random (size_t limit);
+void bench_end (unsigned long ops);
+
+#endif /* tests/memory/bench.h */
@@ -0,0 +1,40 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# Checks the output of an allocator benchmark and reports the
+# numbers it printed, plus operations per timer tick, taking the
+# kernel and user ticks from the statistics printed at shutdown.
+sub check_bench {
+    our ($test);
+    my ($name) = $test =~ m%([^/]+)$%;
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+
+    my ($ticks);
+    foreach (@output) {
+	$ticks = $1 + $2
+	  if /^Thread: \d+ idle ticks, (\d+) kernel ticks, (\d+) user ticks$/;
+    }
+
+    my (@core) = get_core_output ("run", @output);
+    fail "missing begin message\n" if $core[0] ne "($name) begin";
+    fail "missing end message\n" if !grep ($_ eq "($name) end", @core);
+    fail "benchmark did not exit cleanly\n"
+      if !grep ($_ eq "$name: exit(0)", @core);
+
+    my (@results);
+    my ($ops);
+    foreach (@core) {
+	next if !/^\(\Q$name\E\) ([a-z ]+): (\d+%?)$/;
+	push (@results, "$1: $2");
+	$ops = $2 if $1 eq 'ops';
+    }
+    fail "missing operation count\n" if !defined $ops;
+    push (@results, sprintf ("ops per tick: %.1f", $ops / $ticks))
+      if $ticks;
+    pass (@results);
+}
+
+1;
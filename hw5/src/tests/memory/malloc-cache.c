@@ -0,0 +1,75 @@
+/* Allocates and frees short-lived objects of a few fixed sizes
+   in tight loops.  Freed blocks should be handed straight back
+   by the next request of the same size, and the heap should not
+   grow once the loop is warm. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define NUM_ROUNDS (1 << 15)
+#define BATCH_SIZE 8
+
+static const size_t sizes[] = {16, 24, 48, 100};
+#define NUM_SIZES (sizeof sizes / sizeof *sizes)
+
+static void
+pairs (void)
+{
+  for (size_t i = 0; i != NUM_SIZES; i++) {
+    char* first = malloc(sizes[i]);
+    free(first);
+    for (int j = 0; j != NUM_ROUNDS; j++) {
+      char* p = malloc(sizes[i]);
+      ASSERT(p == first);
+      memset(p, 0x5a, sizes[i]);
+      free(p);
+    }
+  }
+}
+
+static void
+batches (void)
+{
+  char* objects[NUM_SIZES][BATCH_SIZE];
+
+  for (int j = 0; j != NUM_ROUNDS / BATCH_SIZE; j++) {
+    for (size_t i = 0; i != NUM_SIZES; i++)
+      for (int k = 0; k != BATCH_SIZE; k++) {
+        objects[i][k] = malloc(sizes[i]);
+        ASSERT(objects[i][k] != NULL);
+        memset(objects[i][k], k, sizes[i]);
+      }
+    for (size_t i = 0; i != NUM_SIZES; i++)
+      for (int k = 0; k != BATCH_SIZE; k++) {
+        ASSERT(objects[i][k][sizes[i] - 1] == k);
+        free(objects[i][k]);
+      }
+  }
+}
+
+void
+test_main (void)
+{
+  /* Warm up so that the heap has its initial size. */
+  free(malloc(sizes[0]));
+  void* brk = sbrk(0);
+
+  pairs();
+  msg("pairs done");
+  batches();
+  msg("batches done");
+
+  ASSERT(sbrk(0) == brk);
+}
+
+int
+main (int argc UNUSED, char *argv[] UNUSED)
+{
+  test_name = "malloc-cache";
+  msg ("begin");
+  test_main();
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-cache) begin
+(malloc-cache) pairs done
+(malloc-cache) batches done
+(malloc-cache) end
+malloc-cache: exit(0)
+EOF
+pass;
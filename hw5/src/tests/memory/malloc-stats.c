@@ -0,0 +1,89 @@
+/* Checks the numbers reported by malloc_get_stats() as blocks
+   are allocated, split, merged, and given back to the kernel. */
+
+#include <stdlib.h>
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define NUM_INTS (1 << 12)
+#define MEBI (1 << 20)
+#define NUM_SMALL 100
+
+static struct malloc_stats
+get_stats (void)
+{
+  struct malloc_stats stats;
+  malloc_get_stats(&stats);
+  ASSERT(malloc_check_heap(false));
+  return stats;
+}
+
+void
+test_main (void)
+{
+  /* Start from a warm heap. */
+  free(malloc(1));
+  struct malloc_stats base = get_stats();
+
+  int* p = malloc(NUM_INTS * sizeof(int));
+  int* q = malloc(NUM_INTS * sizeof(int));
+  struct malloc_stats s = get_stats();
+  ASSERT(s.in_use_bytes >= base.in_use_bytes + 2 * NUM_INTS * sizeof(int));
+  ASSERT(s.heap_size == s.in_use_bytes + s.cached_bytes + s.free_bytes
+         + base.heap_size - base.in_use_bytes - base.cached_bytes
+         - base.free_bytes);
+  msg("allocated two blocks");
+
+  free(p);
+  s = get_stats();
+  ASSERT(s.free_bytes >= NUM_INTS * sizeof(int));
+  ASSERT(s.class_free_bytes[14 - 4] >= NUM_INTS * sizeof(int));
+  ASSERT(s.largest_free < s.free_bytes);
+  ASSERT(s.fragmentation > 0);
+  msg("freed first block");
+
+  free(q);
+  s = get_stats();
+  ASSERT(s.in_use_bytes == base.in_use_bytes);
+  ASSERT(s.largest_free == s.free_bytes);
+  ASSERT(s.fragmentation == 0);
+  msg("freed second block");
+
+  size_t sbrk_calls = s.sbrk_calls;
+  char* small[NUM_SMALL];
+  for (int i = 0; i != NUM_SMALL; i++)
+    small[i] = malloc(32);
+  for (int i = 0; i != NUM_SMALL; i++)
+    free(small[i]);
+  s = get_stats();
+  ASSERT(s.sbrk_calls == sbrk_calls);
+  msg("small blocks did not call sbrk");
+
+  size_t heap_size = s.heap_size;
+  char* big = malloc(MEBI);
+  s = get_stats();
+  ASSERT(s.span_cnt == 1);
+  ASSERT(s.span_bytes >= MEBI);
+  ASSERT(s.heap_size > heap_size && s.heap_size >= MEBI);
+  ASSERT(s.peak_heap_size >= s.heap_size);
+  msg("allocated a span");
+
+  free(big);
+  s = get_stats();
+  ASSERT(s.span_cnt == 0);
+  ASSERT(s.span_bytes == 0);
+  ASSERT(s.heap_size <= heap_size);
+  ASSERT(s.peak_heap_size >= MEBI);
+  msg("freed the span");
+}
+
+int
+main (int argc UNUSED, char *argv[] UNUSED)
+{
+  test_name = "malloc-stats";
+  msg ("begin");
+  test_main();
+  msg ("end");
+  return 0;
+}
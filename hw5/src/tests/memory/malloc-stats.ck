@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-stats) begin
+(malloc-stats) allocated two blocks
+(malloc-stats) freed first block
+(malloc-stats) freed second block
+(malloc-stats) small blocks did not call sbrk
+(malloc-stats) allocated a span
+(malloc-stats) freed the span
+(malloc-stats) end
+malloc-stats: exit(0)
+EOF
+pass;
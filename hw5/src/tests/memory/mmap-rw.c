@@ -0,0 +1,54 @@
+/* Maps a file, checks that the mapping reads back the file's
+   contents followed by zeros, changes the mapping, unmaps it,
+   and checks that the change reached the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static const char change[] = "=== changed through mmap ===";
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  char buf[sizeof change - 1];
+  int handle;
+  mapid_t map;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, actual)) != MAP_FAILED, "mmap \"sample.txt\"");
+
+  /* Check that data is correct and followed by zeros. */
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of mmap'd file reported bad data");
+  for (i = strlen (sample); i < 4096; i++)
+    if (actual[i] != 0)
+      fail ("byte %zu of mmap'd region has value %02hhx (should be 0)",
+            i, actual[i]);
+
+  /* Change the mapping and unmap it, which writes it back. */
+  memcpy (actual, change, sizeof buf);
+  munmap (map);
+  close (handle);
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+  CHECK (read (handle, buf, sizeof buf) == (int) sizeof buf,
+         "read \"sample.txt\"");
+  if (memcmp (buf, change, sizeof buf))
+    fail ("change through mmap did not reach the file");
+  close (handle);
+}
+
+int
+main (int argc UNUSED, char *argv[] UNUSED)
+{
+  test_name = "mmap-rw";
+  msg ("begin");
+  test_main();
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mmap-rw) begin
+(mmap-rw) open "sample.txt"
+(mmap-rw) mmap "sample.txt"
+(mmap-rw) open "sample.txt" again
+(mmap-rw) read "sample.txt"
+(mmap-rw) end
+mmap-rw: exit(0)
+EOF
+pass;
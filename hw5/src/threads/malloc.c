@@ -13,34 +13,83 @@
 
    The size of each request, in bytes, is rounded up to a power
    of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
-
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   that size.  Blocks are carved out of pages of memory, called
+   "arenas", obtained from the page allocator.  Each arena keeps
+   a list of its free blocks, and the descriptor keeps a list of
+   its arenas that have any free blocks, ordered from the fullest
+   arena to the emptiest.  If that list is nonempty, a block from
+   the fullest arena is used to satisfy the request.
+
+   Otherwise, a new arena is obtained from the page allocator (if
+   none is available, malloc() returns a null pointer).  The new
+   arena is divided into blocks, all of which are added to its
+   free list.  Then we return one of the new blocks.
+
+   When we free a block, we add it to its arena's free list.  But
+   if the arena now has no in-use blocks, we give it back to the
+   page allocator.  Allocating from the fullest arena first lets
+   the emptier arenas drain, so that after a burst of allocations
+   memory actually goes back to the page allocator instead of
+   staying spread thinly over many arenas.  Each descriptor counts
+   its arenas so that malloc_print_stats() can show this.
+
+   Compiling with -DMALLOC_DEBUG (add it to DEFINES in a
+   Make.vars) turns on a leak tracker.  Each block from malloc(),
+   calloc(), or realloc() then starts with a hidden header that
+   points to a record for the code that allocated it, identified
+   by its return address, which counts the blocks and bytes that
+   it still holds.  malloc_dump_sites() prints those records, so
+   that whoever is slowly eating the kernel pool can be found.
+   Look the addresses up with the backtrace tool.
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Objects that the kernel allocates often and that all have the
+   same size can instead come from an object cache created with
+   kmem_cache_create().  A cache is a descriptor whose block size
+   is the object size rounded up only to pointer alignment, so
+   that, for example, a 536-byte `struct inode' takes 536 bytes
+   instead of 1 kB.  A cache may also have a constructor, which
+   initializes each object once, when its arena is created.  Such
+   objects must be freed in their constructed state, so their
+   free list element is kept after the object instead of on top
+   of it.  Each cache keeps statistics, which are also printed by
+   malloc_print_stats(). */
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
-    struct list free_list;      /* List of free blocks. */
+    size_t elem_ofs;            /* Offset of free list element in block. */
+    void (*ctor) (void *);      /* Constructor, or null. */
+    struct list arenas;         /* Arenas with free blocks, fullest first. */
     struct lock lock;           /* Lock. */
+
+    /* Statistics, protected by LOCK. */
+    size_t arena_cnt;           /* Arenas now held. */
+    size_t arena_peak;          /* Most arenas held at once. */
+    long long reclaim_cnt;      /* Arenas given back to palloc. */
+    long long hit_cnt;          /* Allocations from an existing arena. */
+    long long miss_cnt;         /* Allocations that needed a new arena. */
+  };
+
+/* Object cache. */
+struct kmem_cache
+  {
+    struct desc desc;           /* Descriptor for the objects. */
+    const char *name;           /* Name, for statistics. */
+    size_t object_size;         /* Size of each object in bytes. */
+    struct list_elem elem;      /* Element in `caches'. */
+
+    /* Statistics, protected by DESC's lock. */
+    long long alloc_cnt;        /* Objects allocated. */
+    size_t active_cnt;          /* Objects now in use. */
+    size_t peak_cnt;            /* Most objects in use at once. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -52,9 +101,12 @@ struct arena
     unsigned magic;             /* Always set to ARENA_MAGIC. */
     struct desc *desc;          /* Owning descriptor, null for big block. */
     size_t free_cnt;            /* Free blocks; pages in big block. */
+    struct list free_list;      /* List of free blocks. */
+    struct list_elem elem;      /* Element in DESC's `arenas'. */
   };
 
-/* Free block. */
+/* Free block.  Its free list element is at the start of the
+   block, or at its descriptor's ELEM_OFS. */
 struct block
   {
     struct list_elem free_elem; /* Free list element. */
@@ -64,6 +116,47 @@ struct block
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* All object caches. */
+static struct list caches;
+static struct lock caches_lock;
+
+#ifdef MALLOC_DEBUG
+/* Allocation site. */
+struct site
+  {
+    void *caller;               /* Return address, null if unused. */
+    size_t live_cnt;            /* Blocks still allocated. */
+    size_t live_bytes;          /* Bytes still allocated. */
+    long long alloc_cnt;        /* Blocks ever allocated. */
+  };
+
+/* Hidden header at the start of each tracked block. */
+struct site_hdr
+  {
+    struct site *site;          /* Allocation site. */
+    size_t size;                /* Bytes requested. */
+  };
+
+/* Allocation sites, in a hash table with linear probing.  Sites
+   that do not fit are counted in OTHER_SITE. */
+#define SITE_CNT 128
+static struct site sites[SITE_CNT];
+static struct site other_site;
+static struct lock sites_lock;
+
+static struct site *find_site (void *caller);
+static void print_site (const struct site *);
+#endif
+
+static void *alloc (size_t, void *caller);
+static void *alloc_block (size_t);
+static void free_block (void *);
+
+static void init_desc (struct desc *, size_t block_size, size_t elem_ofs,
+                       void (*ctor) (void *));
+static void *desc_alloc (struct desc *);
+static void desc_free (struct desc *, void *);
+static struct list_elem *block_elem (struct desc *, void *);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
@@ -77,21 +170,59 @@ malloc_init (void)
     {
       struct desc *d = &descs[desc_cnt++];
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
-      lock_init (&d->lock);
+      init_desc (d, block_size, 0, NULL);
     }
+  list_init (&caches);
+  lock_init (&caches_lock);
+#ifdef MALLOC_DEBUG
+  lock_init (&sites_lock);
+#endif
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size)
+{
+  return alloc (size, __builtin_return_address (0));
+}
+
+/* Obtains and returns a new block of at least SIZE bytes on
+   behalf of the code at CALLER.  Returns a null pointer if memory
+   is not available. */
+static void *
+alloc (size_t size, void *caller UNUSED)
+{
+#ifdef MALLOC_DEBUG
+  struct site_hdr *h;
+
+  if (size == 0)
+    return NULL;
+  h = alloc_block (size + sizeof *h);
+  if (h == NULL)
+    return NULL;
+
+  lock_acquire (&sites_lock);
+  h->site = find_site (caller);
+  h->size = size;
+  h->site->live_cnt++;
+  h->site->live_bytes += size;
+  h->site->alloc_cnt++;
+  lock_release (&sites_lock);
+  return h + 1;
+#else
+  return alloc_block (size);
+#endif
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+static void *
+alloc_block (size_t size)
 {
   struct desc *d;
-  struct block *b;
   struct arena *a;
+  void *b;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -120,35 +251,7 @@ malloc (size_t size)
     }
 
   lock_acquire (&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
-    {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL)
-        {
-          lock_release (&d->lock);
-          return NULL;
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++)
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
-    }
-
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
+  b = desc_alloc (d);
   lock_release (&d->lock);
   return b;
 }
@@ -167,7 +270,7 @@ calloc (size_t a, size_t b)
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc (size);
+  p = alloc (size, __builtin_return_address (0));
   if (p != NULL)
     memset (p, 0, size);
 
@@ -178,11 +281,15 @@ calloc (size_t a, size_t b)
 static size_t
 block_size (void *block)
 {
+#ifdef MALLOC_DEBUG
+  return ((struct site_hdr *) block - 1)->size;
+#else
   struct block *b = block;
   struct arena *a = block_to_arena (b);
   struct desc *d = a->desc;
 
   return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
+#endif
 }
 
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
@@ -201,7 +308,7 @@ realloc (void *old_block, size_t new_size)
     }
   else
     {
-      void *new_block = malloc (new_size);
+      void *new_block = alloc (new_size, __builtin_return_address (0));
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
@@ -217,6 +324,27 @@ realloc (void *old_block, size_t new_size)
    malloc(), calloc(), or realloc(). */
 void
 free (void *p)
+{
+#ifdef MALLOC_DEBUG
+  if (p != NULL)
+    {
+      struct site_hdr *h = (struct site_hdr *) p - 1;
+
+      lock_acquire (&sites_lock);
+      ASSERT (h->site->live_cnt > 0);
+      h->site->live_cnt--;
+      h->site->live_bytes -= h->size;
+      lock_release (&sites_lock);
+      p = h;
+    }
+#endif
+  free_block (p);
+}
+
+/* Frees block P, which must have been previously allocated with
+   alloc_block(). */
+static void
+free_block (void *p)
 {
   if (p != NULL)
     {
@@ -227,6 +355,7 @@ free (void *p)
       if (d != NULL)
         {
           /* It's a normal block.  We handle it here. */
+          ASSERT (d >= descs && d < descs + desc_cnt);
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
@@ -234,24 +363,7 @@ free (void *p)
 #endif
 
           lock_acquire (&d->lock);
-
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena)
-            {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++)
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
-            }
-
+          desc_free (d, b);
           lock_release (&d->lock);
         }
       else
@@ -263,6 +375,297 @@ free (void *p)
     }
 }
 
+/* Creates and returns an object cache named NAME for objects of
+   SIZE bytes.  If CTOR is nonnull, it is called on each object
+   once, before the object is first allocated, and objects must be
+   in their constructed state when they are freed.  CTOR may not
+   allocate from the new cache.  Panics if memory is not
+   available, since caches are created during initialization. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, void (*ctor) (void *))
+{
+  struct kmem_cache *c;
+  size_t elem_ofs, block_size;
+
+  ASSERT (size > 0);
+
+  /* Put the free list element after a constructed object, and
+     on top of any other object. */
+  if (ctor != NULL)
+    {
+      elem_ofs = ROUND_UP (size, sizeof (void *));
+      block_size = elem_ofs + sizeof (struct block);
+    }
+  else
+    {
+      elem_ofs = 0;
+      block_size = ROUND_UP (size > sizeof (struct block)
+                             ? size : sizeof (struct block),
+                             sizeof (void *));
+    }
+  if (block_size > PGSIZE - sizeof (struct arena))
+    PANIC ("%s: %zu-byte objects are too big for a cache", name, size);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    PANIC ("%s: out of memory creating cache", name);
+  init_desc (&c->desc, block_size, elem_ofs, ctor);
+  c->name = name;
+  c->object_size = size;
+  c->alloc_cnt = 0;
+  c->active_cnt = 0;
+  c->peak_cnt = 0;
+
+  lock_acquire (&caches_lock);
+  list_push_back (&caches, &c->elem);
+  lock_release (&caches_lock);
+  return c;
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  void *object;
+
+  lock_acquire (&c->desc.lock);
+  object = desc_alloc (&c->desc);
+  if (object != NULL)
+    {
+      c->alloc_cnt++;
+      if (++c->active_cnt > c->peak_cnt)
+        c->peak_cnt = c->active_cnt;
+    }
+  lock_release (&c->desc.lock);
+  return object;
+}
+
+/* Returns OBJECT, which must have been obtained from cache C, to
+   C.  A null OBJECT is ignored. */
+void
+kmem_cache_free (struct kmem_cache *c, void *object)
+{
+  if (object == NULL)
+    return;
+
+  ASSERT (block_to_arena (object)->desc == &c->desc);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it must stay constructed. */
+  if (c->desc.ctor == NULL)
+    memset (object, 0xcc, c->object_size);
+#endif
+
+  lock_acquire (&c->desc.lock);
+  c->active_cnt--;
+  desc_free (&c->desc, object);
+  lock_release (&c->desc.lock);
+}
+
+/* Prints statistics for each malloc() descriptor that has been
+   used and for each object cache. */
+void
+malloc_print_stats (void)
+{
+  struct list_elem *e;
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->arena_peak > 0)
+      printf ("Malloc: %zu-byte blocks, %lld hits, %lld misses, "
+              "%zu pages (peak %zu), %lld pages reclaimed\n",
+              d->block_size, d->hit_cnt, d->miss_cnt, d->arena_cnt,
+              d->arena_peak, d->reclaim_cnt);
+
+  lock_acquire (&caches_lock);
+  for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      printf ("Cache %s: %zu-byte objects, %lld allocated, "
+              "%zu in use (peak %zu), %zu pages (peak %zu)\n",
+              c->name, c->object_size, c->alloc_cnt, c->active_cnt,
+              c->peak_cnt, c->desc.arena_cnt, c->desc.arena_peak);
+    }
+  lock_release (&caches_lock);
+
+  malloc_dump_sites ();
+}
+
+/* Prints the number of blocks and bytes that each allocation
+   site still holds.  Does nothing unless the kernel was compiled
+   with MALLOC_DEBUG. */
+void
+malloc_dump_sites (void)
+{
+#ifdef MALLOC_DEBUG
+  size_t i;
+
+  lock_acquire (&sites_lock);
+  for (i = 0; i < SITE_CNT; i++)
+    print_site (&sites[i]);
+  print_site (&other_site);
+  lock_release (&sites_lock);
+#endif
+}
+
+/* Initializes descriptor D for blocks of BLOCK_SIZE bytes, whose
+   free list elements are ELEM_OFS bytes into each block, and that
+   are constructed with CTOR if it is nonnull. */
+static void
+init_desc (struct desc *d, size_t block_size, size_t elem_ofs,
+           void (*ctor) (void *))
+{
+  d->block_size = block_size;
+  d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+  d->elem_ofs = elem_ofs;
+  d->ctor = ctor;
+  list_init (&d->arenas);
+  lock_init (&d->lock);
+  d->arena_cnt = 0;
+  d->arena_peak = 0;
+  d->reclaim_cnt = 0;
+  d->hit_cnt = 0;
+  d->miss_cnt = 0;
+}
+
+/* Takes a block from descriptor D, which must be locked, and
+   returns it.  The block comes from D's fullest arena that has a
+   free block, or from a new arena if there is none.  Returns a
+   null pointer if memory is not available. */
+static void *
+desc_alloc (struct desc *d)
+{
+  struct arena *a;
+  struct list_elem *e;
+
+  /* If no arena has a free block, create a new arena. */
+  if (!list_empty (&d->arenas))
+    d->hit_cnt++;
+  else
+    {
+      size_t i;
+
+      d->miss_cnt++;
+
+      /* Allocate a page. */
+      a = palloc_get_page (0);
+      if (a == NULL)
+        return NULL;
+
+      /* Initialize arena and add its blocks to its free list. */
+      a->magic = ARENA_MAGIC;
+      a->desc = d;
+      a->free_cnt = d->blocks_per_arena;
+      list_init (&a->free_list);
+      for (i = 0; i < d->blocks_per_arena; i++)
+        {
+          struct block *b = arena_to_block (a, i);
+          if (d->ctor != NULL)
+            d->ctor (b);
+          list_push_back (&a->free_list, block_elem (d, b));
+        }
+      list_push_front (&d->arenas, &a->elem);
+      if (++d->arena_cnt > d->arena_peak)
+        d->arena_peak = d->arena_cnt;
+    }
+
+  /* Get a block from the fullest arena and return it.  The arena
+     only gets fuller, so it stays first, unless it is now full. */
+  a = list_entry (list_front (&d->arenas), struct arena, elem);
+  e = list_pop_front (&a->free_list);
+  if (--a->free_cnt == 0)
+    list_remove (&a->elem);
+  return (uint8_t *) e - d->elem_ofs;
+}
+
+/* Returns block B to descriptor D, which must be locked.  If B's
+   arena is now entirely unused, gives it back to the page
+   allocator. */
+static void
+desc_free (struct desc *d, void *b)
+{
+  struct arena *a = block_to_arena (b);
+  bool was_full = a->free_cnt == 0;
+
+  /* Add block to its arena's free list. */
+  list_push_front (&a->free_list, block_elem (d, b));
+
+  /* If the arena is now entirely unused, free it. */
+  if (++a->free_cnt >= d->blocks_per_arena)
+    {
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      if (!was_full)
+        list_remove (&a->elem);
+      palloc_free_page (a);
+      d->arena_cnt--;
+      d->reclaim_cnt++;
+    }
+  else if (was_full)
+    {
+      /* With one free block, A is at least as full as any other
+         arena on the list. */
+      list_push_front (&d->arenas, &a->elem);
+    }
+  else
+    {
+      /* Move A back past the arenas that are now fuller. */
+      struct list_elem *e = list_next (&a->elem);
+      if (e != list_end (&d->arenas)
+          && list_entry (e, struct arena, elem)->free_cnt < a->free_cnt)
+        {
+          list_remove (&a->elem);
+          while (e != list_end (&d->arenas)
+                 && list_entry (e, struct arena, elem)->free_cnt < a->free_cnt)
+            e = list_next (e);
+          list_insert (e, &a->elem);
+        }
+    }
+}
+
+#ifdef MALLOC_DEBUG
+/* Returns the record for allocation site CALLER, creating it if
+   necessary.  sites_lock must be held. */
+static struct site *
+find_site (void *caller)
+{
+  size_t start = ((uintptr_t) caller >> 2) % SITE_CNT;
+  size_t i;
+
+  for (i = 0; i < SITE_CNT; i++)
+    {
+      struct site *s = &sites[(start + i) % SITE_CNT];
+      if (s->caller == caller)
+        return s;
+      if (s->caller == NULL)
+        {
+          s->caller = caller;
+          return s;
+        }
+    }
+  return &other_site;
+}
+
+/* Prints site S, if it still holds any blocks. */
+static void
+print_site (const struct site *s)
+{
+  if (s->live_cnt > 0)
+    printf ("Malloc site %p: %zu blocks, %zu bytes live, "
+            "%lld allocated\n",
+            s->caller, s->live_cnt, s->live_bytes, s->alloc_cnt);
+}
+#endif
+
+/* Returns block B's free list element in descriptor D. */
+static struct list_elem *
+block_elem (struct desc *d, void *b)
+{
+  struct block *fb = (struct block *) ((uint8_t *) b + d->elem_ofs);
+  return &fb->free_elem;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
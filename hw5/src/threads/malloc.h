@@ -9,5 +9,13 @@ void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+void malloc_print_stats (void);
+void malloc_dump_sites (void);
+
+/* Object caches. */
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+                                      void (*ctor) (void *));
+void *kmem_cache_alloc (struct kmem_cache *) __attribute__ ((malloc));
+void kmem_cache_free (struct kmem_cache *, void *);
 
 #endif /* threads/malloc.h */
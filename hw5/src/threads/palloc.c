@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,14 +24,52 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
 
-/* A memory pool. */
+   Pages can also be reserved ahead of time with palloc_reserve(),
+   which sets them aside without allocating them.  Ordinary
+   allocations may not dip into reserved pages, so a later
+   allocation with PAL_RESERVED that draws on a reservation is
+   guaranteed to succeed.  This lets sbrk() promise memory that is
+   only allocated when it is first touched.
+
+   While the CPU would otherwise be idle, the idle thread calls
+   palloc_prezero() to zero free pages ahead of time.  Each pool
+   keeps up to ZEROED_MAX of them, so that PAL_ZERO requests for
+   single pages, which come from page faults and page table
+   creation, usually need not clear memory themselves.  A
+   pre-zeroed page is marked used in its pool's bitmap but still
+   counts as free, and is handed out for any request once the
+   bitmap has no free pages left.  So is the page the idle thread
+   is in the middle of zeroing: an allocation that needs it takes
+   it away, and the idle thread abandons it. */
+
+/* Maximum number of pre-zeroed pages per pool. */
+#define ZEROED_MAX 32
+
+/* Number of bytes the idle thread zeroes at a time with
+   interrupts off. */
+#define ZERO_CHUNK 512
+
+/* A memory pool.
+   The lock serializes allocations and reservations.  Pages are
+   freed without it, so FREE_CNT and the bits of USED_MAP are
+   only changed with atomic instructions.  FREE_CNT lets an
+   allocation that cannot succeed fail without searching
+   USED_MAP.  ZEROED, ZEROED_CNT, and ZEROING are only accessed
+   with interrupts off, because the idle thread may not block on
+   the lock. */
 struct pool
   {
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    size_t free_cnt;                    /* Number of free pages. */
+    size_t reserved_cnt;                /* Free pages set aside. */
+    size_t next_idx;                    /* Where to start the next search. */
+    void *zeroed[ZEROED_MAX];           /* Free pages already zeroed. */
+    size_t zeroed_cnt;                  /* Number of pages in ZEROED. */
+    void *zeroing;                      /* Free page being zeroed. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +78,24 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static bool take_pages (struct pool *, enum palloc_flags, size_t page_cnt);
+static size_t scan_pages (struct pool *, size_t page_cnt);
+static void *get_page (struct pool *, enum palloc_flags, bool *zeroed);
+static void *pop_zeroed (struct pool *);
+static void *take_zeroing (struct pool *);
+static void flush_zeroed (struct pool *);
+static bool prezero (struct pool *);
+
+/* Adds N to *CNT.  This is equivalent to `*cnt += n' except that
+   it is guaranteed to be atomic on a uniprocessor machine, so
+   that pages may be freed without the pool lock, as they are
+   when a dying thread's page is freed with interrupts off.  See
+   the description of the ADD instruction in [IA32-v2a]. */
+static inline void
+count_add (size_t *cnt, size_t n)
+{
+  asm ("addl %1, %0" : "+m" (*cnt) : "r" (n) : "cc");
+}
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -71,27 +128,42 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
+  void *pages = NULL;
   size_t page_idx;
+  bool zeroed = false;
 
   if (page_cnt == 0)
     return NULL;
 
   lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  if (take_pages (pool, flags, page_cnt))
+    {
+      if (page_cnt == 1)
+        pages = get_page (pool, flags, &zeroed);
+      else
+        {
+          /* Pre-zeroed pages may be in the way of a large enough
+             run of free pages. */
+          page_idx = scan_pages (pool, page_cnt);
+          if (page_idx == BITMAP_ERROR)
+            {
+              flush_zeroed (pool);
+              page_idx = scan_pages (pool, page_cnt);
+            }
+          if (page_idx != BITMAP_ERROR)
+            pages = pool->base + PGSIZE * page_idx;
+          else
+            count_add (&pool->free_cnt, page_cnt);
+        }
+      if (pages != NULL && (flags & PAL_RESERVED))
+        pool->reserved_cnt -= page_cnt;
+    }
   lock_release (&pool->lock);
 
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
-
   if (pages != NULL)
     {
-      if (flags & PAL_ZERO){
-      //printf("p_multi\n");
+      if ((flags & PAL_ZERO) && !zeroed)
         memset (pages, 0, PGSIZE * page_cnt);
-      }
     }
   else
     {
@@ -142,6 +214,7 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  count_add (&pool->free_cnt, page_cnt);
 }
 
 /* Frees the page at PAGE. */
@@ -151,6 +224,123 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages in the user pool if PAL_USER is
+   set in FLAGS, otherwise in the kernel pool, that are free and
+   not reserved. */
+size_t
+palloc_available (enum palloc_flags flags)
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  size_t avail;
+
+  lock_acquire (&pool->lock);
+  avail = pool->free_cnt - pool->reserved_cnt;
+  lock_release (&pool->lock);
+  return avail;
+}
+
+/* Sets aside PAGE_CNT free pages in the user pool if PAL_USER is
+   set in FLAGS, otherwise in the kernel pool, so that they can
+   later be obtained with PAL_RESERVED.  Returns true if
+   successful, false if fewer than PAGE_CNT pages are free and not
+   already reserved. */
+bool
+palloc_reserve (enum palloc_flags flags, size_t page_cnt)
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  bool success;
+
+  lock_acquire (&pool->lock);
+  success = pool->free_cnt - pool->reserved_cnt >= page_cnt;
+  if (success)
+    pool->reserved_cnt += page_cnt;
+  lock_release (&pool->lock);
+  return success;
+}
+
+/* Releases PAGE_CNT pages reserved with palloc_reserve() without
+   allocating them. */
+void
+palloc_unreserve (enum palloc_flags flags, size_t page_cnt)
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+
+  lock_acquire (&pool->lock);
+  ASSERT (pool->reserved_cnt >= page_cnt);
+  pool->reserved_cnt -= page_cnt;
+  lock_release (&pool->lock);
+}
+
+/* Zeroes one free page ahead of time, so that a later PAL_ZERO
+   allocation can skip clearing it.  Returns true if a page was
+   zeroed, false if the pools already hold as many pre-zeroed
+   pages as they may or no page can be spared.
+
+   Called by the idle thread, so this never blocks: rather than
+   waiting for a pool's lock, it gives up if the lock is held. */
+bool
+palloc_prezero (void)
+{
+  if (user_pool.zeroed_cnt <= kernel_pool.zeroed_cnt)
+    return prezero (&user_pool) || prezero (&kernel_pool);
+  else
+    return prezero (&kernel_pool) || prezero (&user_pool);
+}
+
+/* Zeroes one of POOL's free pages ahead of time.  Returns true
+   if successful, false if POOL's pre-zeroed pages are at their
+   maximum, its lock is held, it has no page to spare, or the
+   page was taken by an allocation before it was zeroed. */
+static bool
+prezero (struct pool *pool)
+{
+  enum intr_level old_level;
+  size_t page_idx = BITMAP_ERROR;
+  uint8_t *page;
+  size_t ofs;
+  bool success;
+
+  /* Mark the page used, so that it is not handed out twice, but
+     leave it counted as free: an allocation that finds no other
+     page takes it with take_zeroing(). */
+  old_level = intr_disable ();
+  if (pool->zeroed_cnt < ZEROED_MAX && pool->lock.holder == NULL)
+    page_idx = scan_pages (pool, 1);
+  if (page_idx == BITMAP_ERROR)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  page = pool->base + PGSIZE * page_idx;
+  pool->zeroing = page;
+  intr_set_level (old_level);
+
+  /* Zero the page a chunk at a time with interrupts off, checking
+     before each chunk that the page is still ours, so that an
+     allocation never gets a page that is still being written. */
+  for (ofs = 0; ofs < PGSIZE; ofs += ZERO_CHUNK)
+    {
+      old_level = intr_disable ();
+      if (pool->zeroing != page)
+        {
+          intr_set_level (old_level);
+          return false;
+        }
+      memset (page + ofs, 0, ZERO_CHUNK);
+      intr_set_level (old_level);
+    }
+
+  old_level = intr_disable ();
+  success = pool->zeroing == page;
+  if (success)
+    {
+      pool->zeroing = NULL;
+      pool->zeroed[pool->zeroed_cnt++] = page;
+    }
+  intr_set_level (old_level);
+  return success;
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -170,6 +360,125 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   lock_init (&p->lock);
   p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
   p->base = base + bm_pages * PGSIZE;
+  p->free_cnt = page_cnt;
+  p->reserved_cnt = 0;
+  p->next_idx = 0;
+  p->zeroed_cnt = 0;
+  p->zeroing = NULL;
+}
+
+/* Accounts for taking PAGE_CNT pages from POOL, which must be
+   locked.  Pages drawn on a reservation (PAL_RESERVED in FLAGS)
+   are always available; others may only come from the pages
+   that are neither allocated nor reserved.  Returns true if
+   successful, false if too few pages are available. */
+static bool
+take_pages (struct pool *pool, enum palloc_flags flags, size_t page_cnt)
+{
+  size_t avail = pool->free_cnt;
+
+  if (flags & PAL_RESERVED)
+    {
+      ASSERT (pool->reserved_cnt >= page_cnt);
+    }
+  else
+    avail -= pool->reserved_cnt;
+  if (avail < page_cnt)
+    return false;
+  count_add (&pool->free_cnt, -page_cnt);
+  return true;
+}
+
+/* Finds PAGE_CNT consecutive free pages in POOL's bitmap, marks
+   them used, and returns the index of the first one, or
+   BITMAP_ERROR if there are none.  POOL must be locked.
+
+   The search is next-fit: it starts where the last one left off
+   and wraps around to the start of the pool, so that allocations
+   do not rescan the used pages at the bottom of a filling pool
+   over and over. */
+static size_t
+scan_pages (struct pool *pool, size_t page_cnt)
+{
+  size_t page_idx;
+
+  page_idx = bitmap_scan_and_flip (pool->used_map, pool->next_idx, page_cnt,
+                                   false);
+  if (page_idx == BITMAP_ERROR && pool->next_idx > 0)
+    page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  if (page_idx != BITMAP_ERROR)
+    pool->next_idx = page_idx + page_cnt;
+  return page_idx;
+}
+
+/* Takes one page from POOL, which must be locked and have
+   accounted for the page with take_pages(), and returns it.
+   Prefers a pre-zeroed page if PAL_ZERO is set in FLAGS, and
+   otherwise searches the pool's bitmap, falling back on a
+   pre-zeroed page, and then on the page being zeroed, if the
+   bitmap has no free pages left.  Sets *ZEROED to true if the
+   page returned is already zeroed. */
+static void *
+get_page (struct pool *pool, enum palloc_flags flags, bool *zeroed)
+{
+  void *page = NULL;
+  size_t page_idx;
+
+  if (flags & PAL_ZERO)
+    page = pop_zeroed (pool);
+  if (page == NULL)
+    {
+      page_idx = scan_pages (pool, 1);
+      if (page_idx != BITMAP_ERROR)
+        return pool->base + PGSIZE * page_idx;
+      page = pop_zeroed (pool);
+      if (page == NULL)
+        return take_zeroing (pool);
+    }
+  *zeroed = true;
+  return page;
+}
+
+/* Removes and returns one of POOL's pre-zeroed pages, or a null
+   pointer if it has none. */
+static void *
+pop_zeroed (struct pool *pool)
+{
+  enum intr_level old_level = intr_disable ();
+  void *page = NULL;
+
+  if (pool->zeroed_cnt > 0)
+    page = pool->zeroed[--pool->zeroed_cnt];
+  intr_set_level (old_level);
+  return page;
+}
+
+/* Takes away the page that the idle thread is zeroing in POOL
+   and returns it, or a null pointer if there is none.  The
+   page's contents are undefined. */
+static void *
+take_zeroing (struct pool *pool)
+{
+  enum intr_level old_level = intr_disable ();
+  void *page = pool->zeroing;
+
+  pool->zeroing = NULL;
+  intr_set_level (old_level);
+  return page;
+}
+
+/* Returns all of POOL's pre-zeroed pages, and the page being
+   zeroed, to its bitmap.  POOL must be locked. */
+static void
+flush_zeroed (struct pool *pool)
+{
+  void *page;
+
+  while ((page = pop_zeroed (pool)) != NULL)
+    bitmap_reset (pool->used_map, pg_no (page) - pg_no (pool->base));
+  page = take_zeroing (pool);
+  if (page != NULL)
+    bitmap_reset (pool->used_map, pg_no (page) - pg_no (pool->base));
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -8,13 +9,18 @@ enum palloc_flags
   {
     PAL_ASSERT = 001,           /* Panic on failure. */
     PAL_ZERO = 002,             /* Zero page contents. */
-    PAL_USER = 004              /* User page. */
+    PAL_USER = 004,             /* User page. */
+    PAL_RESERVED = 010          /* Draw on an earlier palloc_reserve(). */
   };
 
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
+size_t palloc_available (enum palloc_flags);
+bool palloc_reserve (enum palloc_flags, size_t page_cnt);
+void palloc_unreserve (enum palloc_flags, size_t page_cnt);
+bool palloc_prezero (void);
 void palloc_free_multiple (void *, size_t page_cnt);
 
 #endif /* threads/palloc.h */
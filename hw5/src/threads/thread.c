@@ -98,7 +98,6 @@ thread_init (void)
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
-  //initial_thread->stack_inc_count = 1;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -396,6 +395,11 @@ idle (void *idle_started_ UNUSED)
 
   for (;;)
     {
+      /* Zero free pages ahead of time until there is something
+         better to do. */
+      while (list_empty (&ready_list) && palloc_prezero ())
+        continue;
+
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
@@ -465,13 +469,15 @@ init_thread (struct thread *t, const char *name, int priority)
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
   t->magic = THREAD_MAGIC;
-  t->stack_inc_count = 1; 
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
   intr_set_level (old_level);
+#ifdef USERPROG
   t->heap_start_address = NULL;
   t->sbrk = NULL;
+  list_init (&t->mappings);
+#endif
 
 }
 
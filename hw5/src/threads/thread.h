@@ -2,6 +2,7 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
 #include "threads/synch.h"
@@ -101,9 +102,24 @@ struct thread
 
     struct file* open_file;             /* Single open file supported. */
     bool in_syscall;                    /* Stores if we are in a syscall. */
-    int stack_inc_count;
+    void *user_esp;                     /* User stack pointer in a syscall. */
     uint8_t *heap_start_address;
     uint8_t *sbrk;
+    struct hash pages;                  /* Supplemental page table. */
+    struct file *exec_file;             /* Executable, read on demand. */
+    struct list mappings;               /* Memory-mapped files. */
+    int next_mapid;                     /* Next memory mapping id. */
+    uint8_t *last_fault;                /* Page of the last page fault. */
+    unsigned fault_window;              /* Pages to map ahead of a fault. */
+
+    /* Memory statistics, printed at exit with -ps. */
+    unsigned minor_faults;              /* Faults mapped without I/O. */
+    unsigned major_faults;              /* Faults read from file or swap. */
+    unsigned stack_faults;              /* Faults that grew the stack. */
+    unsigned sbrk_mapped;               /* Pages added by sbrk(). */
+    unsigned sbrk_unmapped;             /* Pages removed by sbrk(). */
+    unsigned resident_cnt;              /* Pages now resident. */
+    unsigned resident_peak;             /* Most pages resident at once. */
 #endif
 
     /* Owned by thread.c. */
@@ -8,13 +8,17 @@
 #include "userprog/syscall.h"
 #include "threads/palloc.h"
 #include "userprog/pagedir.h"
+#include "vm/page.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
-static bool install_page (void *upage, void *kpage, bool writable);
+static bool is_stack_access (const void *fault_addr, const void *esp);
+
+/* Maximum size of a user stack, in pages.  8 MB by default. */
+size_t stack_page_limit = 2048;
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -70,6 +74,7 @@ void
 exception_print_stats (void)
 {
   printf ("Exception: %lld page faults\n", page_fault_cnt);
+  page_print_stats ();
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -155,6 +160,26 @@ page_fault (struct intr_frame *f)
 
   struct thread* t = thread_current ();
 
+  /* Pages recorded in the supplemental page table are mapped on
+     first touch, by the user program or by a system call reading
+     or writing a user buffer. */
+  if (not_present && t->pagedir != NULL && is_user_vaddr (fault_addr)
+      && page_load (fault_addr))
+    return;
+
+  /* Grow the stack by the faulting page if the access is to a
+     stack address the process may be about to use.  In a system
+     call, judge by the user stack pointer saved on entry. */
+  if (not_present && (user || t->in_syscall)
+      && is_stack_access (fault_addr, user ? f->esp : t->user_esp))
+    {
+      void *upage = pg_round_down (fault_addr);
+      t->stack_faults++;
+      if (page_add_zero (upage, true, false) != NULL && page_load (upage))
+        return;
+      syscall_exit (-1);
+    }
+
   /*
    * If we faulted on a user address in kernel mode while handling a syscall,
    * then it's because the user provided invalid syscall arguments. Our checks
@@ -167,59 +192,9 @@ page_fault (struct intr_frame *f)
   if (!user && t->in_syscall && is_user_vaddr (fault_addr))
     syscall_exit (-1);
 
-  /*
-   * If we faulted in user mode, then we assume it's an invalid memory access
-   * and terminate the process. In Homework 5, Part A, you should no longer
-   * assume this; depending on the nature of the fault, the stack may need to
-   * be grown.
-   */
-
-   //start from PHYS_BASE - 20
-   //pg_round_down for upage
-   //validate check //kernal, not user, null? push sth can not be away from esp 32 
-  if (user) {
-   bool expand_success = false;
-
-    // check fault_addr is valid stack address to expand
-
-   //  if (is_user_vaddr(fault_addr) && (uint8_t *)fault_addr > (uint8_t *)f->esp - 20) 
-   if (is_user_vaddr(fault_addr) && 
-      (f->esp <= fault_addr || (uint8_t *)fault_addr == (uint8_t *)f->esp - 4 || (uint8_t *)fault_addr == (uint8_t *)f->esp - 32)) 
-   {
-      // printf("stack_inc_count %d\n",t->stack_inc_count);
-      // printf("fault_addr %p\n", fault_addr);
-      // printf("up arg %p\n", ((uint8_t *) PHYS_BASE) - (PGSIZE * (t->stack_inc_count + 1)));
-      while((uint8_t *)fault_addr < ((uint8_t *) PHYS_BASE ) - (PGSIZE * t->stack_inc_count + 1)) 
-      {
-        void* upage = pg_round_down(((uint8_t *) PHYS_BASE ) - (PGSIZE * (t->stack_inc_count + 1)));
-        //printf("upage %p\n", upage);
-        void* kpage = (void*)palloc_get_page(PAL_USER | PAL_ZERO);
-        bool writable = true;
-        if (kpage == NULL) {
-         //   printf("kpage is null\n");
-           syscall_exit(-1);
-        } //if (kpage ==null ) {handle overflow} --> map sth to null if kpage==null
-        bool success = pagedir_set_page(t->pagedir, upage, kpage, writable); 
-        if (success) {
-           t->stack_inc_count++;
-          // printf("stack_inc_count %d\n",t->stack_inc_count);
-           expand_success = true;
-        }
-        else {
-         //   printf("set page failed\n");
-           syscall_exit(-1);
-        }
-      }
-
-      if (expand_success) {
-         return;
-      }
-    } else {
-      //  printf("stack expand failed\n");
-       syscall_exit(-1);
-      return;
-    }
-  }
+  /* Any other fault in user mode is an invalid memory access. */
+  if (user)
+    syscall_exit (-1);
 
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
@@ -232,3 +207,20 @@ page_fault (struct intr_frame *f)
   kill (f);
 }
 
+/* Returns true if FAULT_ADDR is an address in the stack region,
+   at most STACK_PAGE_LIMIT pages below PHYS_BASE, that a process
+   whose stack pointer is ESP may legitimately touch: at or above
+   ESP, or 4 or 32 bytes below it, as the PUSH and PUSHA
+   instructions do before moving ESP. */
+static bool
+is_stack_access (const void *fault_addr, const void *esp)
+{
+  const uint8_t *addr = fault_addr;
+
+  if (!is_user_vaddr (addr)
+      || addr < (uint8_t *) PHYS_BASE - stack_page_limit * PGSIZE)
+    return false;
+  return (addr >= (const uint8_t *) esp
+          || addr == (const uint8_t *) esp - 4
+          || addr == (const uint8_t *) esp - 32);
+}
@@ -18,8 +18,13 @@
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "vm/mmap.h"
+#include "vm/page.h"
+
+bool process_stats;
 
 static struct semaphore temporary;
+static void print_stats (void);
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
@@ -107,6 +112,9 @@ process_exit (void)
   pd = cur->pagedir;
   if (pd != NULL)
     {
+      if (process_stats)
+        print_stats ();
+
       /* Correct ordering here is crucial.  We must set
          cur->pagedir to NULL before switching page directories,
          so that a timer interrupt can't switch back to the
@@ -114,13 +122,31 @@ process_exit (void)
          directory before destroying the process's page
          directory, or our active page directory will be one
          that's been freed (and cleared). */
+      mmap_destroy ();
+      page_table_destroy ();
       cur->pagedir = NULL;
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+  file_close (cur->exec_file);
+  cur->exec_file = NULL;
   sema_up (&temporary);
 }
 
+/* Prints the current process's memory statistics. */
+static void
+print_stats (void)
+{
+  struct thread *t = thread_current ();
+
+  printf ("%s: %u page faults (%u minor, %u major, %u stack growth), "
+          "%u sbrk pages mapped, %u unmapped, "
+          "%u pages resident (peak %u)\n",
+          t->name, t->minor_faults + t->major_faults, t->minor_faults,
+          t->major_faults, t->stack_faults, t->sbrk_mapped,
+          t->sbrk_unmapped, t->resident_cnt, t->resident_peak);
+}
+
 /* Sets up the CPU for running user code in the current
    thread.
    This function is called on every context switch. */
@@ -222,10 +248,16 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
   //printf("begining of load 0: \n");
  
-  /* Allocate and activate page directory. */
+  /* Allocate and activate page directory and supplemental page
+     table. */
+  if (!page_table_init ())
+    goto done;
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL)
-    goto done;
+    {
+      page_table_destroy ();
+      goto done;
+    }
   process_activate ();
 
   /* Open executable file. */
@@ -235,6 +267,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
       printf ("load: %s: open failed\n", file_name);
       goto done;
     }
+  file_deny_write (file);
 
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
@@ -340,15 +373,15 @@ load (const char *file_name, void (**eip) (void), void **esp)
   success = true;
 
  done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
+  /* We arrive here whether the load is successful or not.  The
+     executable stays open, and unwritable, until the process
+     exits, because its pages are read on demand. */
+  t->exec_file = file;
   return success;
 }
 
 /* load() helpers. */
 
-static bool install_page (void *upage, void *kpage, bool writable);
-
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
 static bool
@@ -406,8 +439,13 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   Nothing is read here.  Each page is only recorded in the
+   supplemental page table, and page_fault() reads it from FILE
+   the first time the process touches it, so FILE must stay open
+   for the life of the process.
+
    Return true if successful, false if a memory allocation error
-   or disk read error occurs. */
+   occurs. */
 static bool
 load_segment (struct file *file, off_t ofs, uint8_t *upage,
               uint32_t read_bytes, uint32_t zero_bytes, bool writable)
@@ -416,7 +454,6 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
-  file_seek (file, ofs);
   while (read_bytes > 0 || zero_bytes > 0)
     {
       /* Calculate how to fill this page.
@@ -425,31 +462,20 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-      /* Get a page of memory. */
-      uint8_t *kpage = palloc_get_page (PAL_USER);
-      if (kpage == NULL)
+      /* Record the page. */
+      struct page *p;
+      if (page_read_bytes > 0)
+        p = page_add_file (upage, file, ofs, page_read_bytes, writable,
+                           false);
+      else
+        p = page_add_zero (upage, writable, false);
+      if (p == NULL)
         return false;
 
-      /* Load this page. */
-      if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
-        {
-          palloc_free_page (kpage);
-          return false;
-        }
-      memset (kpage + page_read_bytes, 0, page_zero_bytes);
-
-      /* Add the page to the process's address space. */
-      if (!install_page (upage, kpage, writable))
-        {
-          palloc_free_page (kpage);
-          return false;
-        }
-
       /* Advance. */
       read_bytes -= page_read_bytes;
       zero_bytes -= page_zero_bytes;
-      
-      
+      ofs += page_read_bytes;
       upage += PGSIZE;
     }
   return true;
@@ -460,38 +486,11 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 setup_stack (void **esp)
 {
-  uint8_t *kpage;
-  bool success = false;
-
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage != NULL)
-    {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-      if (success)
-        *esp = PHYS_BASE - 20;
-      else
-        palloc_free_page (kpage);
-    }
-  return success;
-}
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
 
-/* Adds a mapping from user virtual address UPAGE to kernel
-   virtual address KPAGE to the page table.
-   If WRITABLE is true, the user process may modify the page;
-   otherwise, it is read-only.
-   UPAGE must not already be mapped.
-   KPAGE should probably be a page obtained from the user pool
-   with palloc_get_page().
-   Returns true on success, false if UPAGE is already mapped or
-   if memory allocation fails. */
-static bool
-install_page (void *upage, void *kpage, bool writable)
-{
-  struct thread *t = thread_current ();
-  
-  /* Verify that there's not already a page at that virtual
-     address, then map our page there. */
-  return (pagedir_get_page (t->pagedir, upage) == NULL
-          && pagedir_set_page (t->pagedir, upage, kpage, writable));
+  if (page_add_zero (upage, true, false) == NULL || !page_load (upage))
+    return false;
+  *esp = PHYS_BASE - 20;
+  return true;
 }
 
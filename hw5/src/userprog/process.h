@@ -1,8 +1,13 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <stdbool.h>
 #include "threads/thread.h"
 
+/* If true, print each process's memory statistics at exit.
+   Controlled by kernel command-line option "-ps". */
+extern bool process_stats;
+
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
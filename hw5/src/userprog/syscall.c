@@ -9,6 +9,9 @@
 #include "filesys/file.h"
 #include "threads/palloc.h"
 #include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/mmap.h"
+#include "vm/page.h"
 
 static void syscall_handler (struct intr_frame *);
 
@@ -100,6 +103,22 @@ syscall_close (int fd)
     }
 }
 
+static mapid_t
+syscall_mmap (int fd, void* addr)
+{
+  struct thread* t = thread_current ();
+  if (fd != 2 || t->open_file == NULL)
+    return MAP_FAILED;
+
+  return mmap_map (t->open_file, addr);
+}
+
+static void
+syscall_munmap (mapid_t mapid)
+{
+  mmap_unmap (mapid);
+}
+
 static void*
 syscall_sbrk(intptr_t increment, struct intr_frame *f) 
 {
@@ -109,82 +128,61 @@ syscall_sbrk(intptr_t increment, struct intr_frame *f)
     return t->sbrk;
   }
   
-  int count = 0;
-  void *kpage_start = NULL;
-  void *upage_start = NULL;
   void *pre_sbrk = t->sbrk;
 
-  if (pagedir_get_page (t->pagedir, t->sbrk + increment) != NULL) {
-    if (increment < 0) {
-      int inc = increment * -1;
-      //printf("increment %d: ",inc);
-      while (count * PGSIZE < inc) {
-        
-        void* upage = pg_round_down((uint8_t *) t->sbrk - count * PGSIZE);
-        void* kpage = pagedir_get_page (t->pagedir, upage);
-        palloc_free_page(kpage);
-        pagedir_clear_page(t->pagedir, upage);
-        count += 1;
-        
-      }
-    } 
-    t->sbrk += increment;
+  if (increment < 0) {
+    /* Remove every page that lies entirely above the new break.
+       The page holding the new break stays. */
+    size_t shrink = -(size_t) increment;
+    if (shrink > (size_t) (t->sbrk - t->heap_start_address))
+      return (void*) -1;
+    uint8_t *new_sbrk = t->sbrk - shrink;
+    for (uint8_t *upage = pg_round_up (new_sbrk); upage < t->sbrk;
+         upage += PGSIZE) {
+      page_remove (upage);
+      t->sbrk_unmapped++;
+    }
+    t->sbrk = new_sbrk;
     return pre_sbrk;
   }
-  
-  
-  if (is_user_vaddr(t->sbrk) && (f->esp > t->sbrk))
-  {
-    while(count * PGSIZE < increment) {
-        
-          //printf("while: increment:%d\n", increment);
-          void* upage = pg_round_down((uint8_t *) t->sbrk + 1 );
-          if (upage_start == NULL) {
-            upage_start = upage;
-          }
-          //printf("upage %p\n", upage);
-          void* kpage = (void*)palloc_get_page(PAL_USER | PAL_ZERO);
-          //printf("kpage %p\n", kpage);
-          if (kpage_start == NULL) {
-            kpage_start = kpage;
-          }
-          bool writable = true;
-          
-          if (kpage == NULL) {
-              
-              palloc_free_multiple(kpage_start, count);
-              for (int i = 0; i < count; i++) {
-                pagedir_clear_page(t->pagedir, upage_start + PGSIZE * i);
-              }
-              t->sbrk = pre_sbrk;
-              //printf("kpage is null 2: %p\n", t->sbrk);
-              return (void*) -1;
-          } 
-          //printf("upage11: %p\n", upage);
-          //printf("kpage11: %p\n", kpage);
-          bool success = pagedir_set_page(t->pagedir, upage, kpage, writable); 
-
-          if (success) {
-            
-              count++;
-              //printf("prev: %p\n", pre_sbrk);
-              if (count * PGSIZE - increment > 0) {
-                //printf("count * PGS: %d\n", count * PGSIZE -  increment);
-                t->sbrk = t->sbrk + ( increment - (count - 1) * PGSIZE);
-              } else {
-                t->sbrk = t->sbrk + PGSIZE;
-              }
-          }
-          else {
-              //printf("set page failed\n");
-              palloc_free_multiple(kpage_start, count);
-              syscall_exit(-1);
-          }
-      }
-    
-   
-  
+
+  /* The heap may not wrap around or run into the stack. */
+  uint8_t *new_sbrk = (uint8_t *) t->sbrk + increment;
+  if (new_sbrk < (uint8_t *) t->sbrk || (void*) new_sbrk >= f->esp)
+    return (void*) -1;
+
+  /* Reserve frames for the new pages, evicting other pages if
+     necessary, and record them as demand-zero pages.
+     page_fault() maps each one on first touch.
+
+     The pages are not zeroed or mapped until they are touched,
+     but each one still holds a frame of the user pool from now
+     until it is freed, so a process that grows its heap and
+     never touches it keeps other processes from using those
+     frames.  In exchange, sbrk() fails cleanly when memory runs
+     short, instead of the process being killed at a later page
+     fault that cannot be satisfied. */
+  uint8_t *upage_start = pg_round_up (t->sbrk);
+  uint8_t *upage_end = pg_round_up (new_sbrk);
+  size_t page_cnt = (upage_end - upage_start) / PGSIZE;
+  frame_acquire ();
+  bool reserved = frame_reserve (page_cnt);
+  frame_release ();
+  if (!reserved)
+    return (void*) -1;
+  for (uint8_t *upage = upage_start; upage < upage_end; upage += PGSIZE) {
+    if (page_add_zero (upage, true, true) == NULL) {
+      /* Out of memory: drop the pages added so far, which gives
+         back their reservations, and the rest of the reservation. */
+      for (uint8_t *p = upage_start; p < upage; p += PGSIZE)
+        page_remove (p);
+      palloc_unreserve (PAL_USER, (upage_end - upage) / PGSIZE);
+      return (void*) -1;
+    }
   }
+
+  t->sbrk_mapped += page_cnt;
+  t->sbrk = new_sbrk;
   return pre_sbrk;
 }
 
@@ -194,6 +192,7 @@ syscall_handler (struct intr_frame *f)
   uint32_t* args = (uint32_t*) f->esp;
   struct thread* t = thread_current ();
   t->in_syscall = true;
+  t->user_esp = f->esp;
 
   validate_buffer_in_user_region (args, sizeof(uint32_t));
   switch (args[0])
@@ -232,6 +231,16 @@ syscall_handler (struct intr_frame *f)
       f->eax = (uint32_t) syscall_sbrk((intptr_t) args[1], f);
       break;
 
+    case SYS_MMAP:
+      validate_buffer_in_user_region (&args[1], 2 * sizeof(uint32_t));
+      f->eax = (uint32_t) syscall_mmap ((int) args[1], (void*) args[2]);
+      break;
+
+    case SYS_MUNMAP:
+      validate_buffer_in_user_region (&args[1], sizeof(uint32_t));
+      syscall_munmap ((mapid_t) args[1]);
+      break;
+
 
     default:
       printf ("Unimplemented system call: %d\n", (int) args[0]);
@@ -0,0 +1,286 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+
+/* Frame table.
+
+   Every frame of the user pool that holds a user page is in the
+   frame table.  When the user pool runs out, frame_alloc()
+   evicts a page with the second-chance ("clock") algorithm: the
+   clock hand sweeps the table, clearing the accessed bit of each
+   page it passes, and evicts the first page found that has not
+   been accessed since the hand last passed it.  page_evict()
+   writes the victim to swap if it must.
+
+   Read-only pages of executables are shared: when a process
+   faults on one, frame_share() looks for a frame that already
+   holds the same part of the same executable, and maps that
+   instead of reading another copy.  The pages mapped to a frame
+   are its references; a frame is freed when its last page goes
+   away, and evicting it unmaps it from every process.
+
+   A single lock protects the frame table, the swap partition,
+   and the residency of every user page.  Page faults and
+   eviction both hold it for their whole duration, so a process
+   that faults on a page that is being evicted waits until the
+   eviction is over and then simply brings the page back in. */
+
+/* Number of user frames that frame_reserve() always leaves free
+   or evictable. */
+#define RESERVE_FLOOR 16
+
+static struct lock frame_lock;      /* Protects everything above. */
+static struct list frames;          /* All frames in use. */
+static struct list_elem *hand;      /* Clock hand. */
+static size_t frame_cnt;            /* Number of frames in FRAMES. */
+static struct hash shared_frames;   /* Shared frames by file position. */
+
+static bool evict (void);
+static bool frame_accessed (struct frame *);
+static void frame_free (struct frame *);
+static hash_hash_func frame_hash;
+static hash_less_func frame_less;
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  lock_init (&frame_lock);
+  list_init (&frames);
+  hand = list_end (&frames);
+  hash_init (&shared_frames, frame_hash, frame_less, NULL);
+}
+
+/* Acquires the frame table lock. */
+void
+frame_acquire (void)
+{
+  lock_acquire (&frame_lock);
+}
+
+/* Releases the frame table lock. */
+void
+frame_release (void)
+{
+  lock_release (&frame_lock);
+}
+
+/* Obtains a frame from the user pool for page P of the current
+   process, evicting another page if the pool is exhausted.  FLAGS
+   may include PAL_ZERO and PAL_RESERVED.  Returns the new frame,
+   or a null pointer if no page can be evicted.  The frame table
+   lock must be held. */
+struct frame *
+frame_alloc (struct page *p, enum palloc_flags flags)
+{
+  struct frame *f;
+  void *kpage;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  f = malloc (sizeof *f);
+  if (f == NULL)
+    return NULL;
+  while ((kpage = palloc_get_page (PAL_USER | flags)) == NULL)
+    if (!evict ())
+      {
+        free (f);
+        return NULL;
+      }
+
+  f->kpage = kpage;
+  list_init (&f->pages);
+  list_push_back (&f->pages, &p->frame_elem);
+  f->inode = NULL;
+  list_push_back (&frames, &f->elem);
+  frame_cnt++;
+  return f;
+}
+
+/* Looks for a shared frame holding READ_BYTES bytes read from
+   INODE at offset OFS and, if there is one, adds page P to it and
+   returns it.  Returns a null pointer if there is none.  The
+   frame table lock must be held. */
+struct frame *
+frame_share (struct page *p, struct inode *inode, off_t ofs,
+             size_t read_bytes)
+{
+  struct frame key;
+  struct hash_elem *e;
+  struct frame *f;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  key.inode = inode;
+  key.ofs = ofs;
+  key.read_bytes = read_bytes;
+  e = hash_find (&shared_frames, &key.hash_elem);
+  if (e == NULL)
+    return NULL;
+  f = hash_entry (e, struct frame, hash_elem);
+  list_push_back (&f->pages, &p->frame_elem);
+  return f;
+}
+
+/* Makes frame F, which holds READ_BYTES bytes read from INODE at
+   offset OFS, available to frame_share().  The frame table lock
+   must be held. */
+void
+frame_make_shared (struct frame *f, struct inode *inode, off_t ofs,
+                   size_t read_bytes)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (f->inode == NULL);
+
+  f->inode = inode;
+  f->ofs = ofs;
+  f->read_bytes = read_bytes;
+  hash_insert (&shared_frames, &f->hash_elem);
+}
+
+/* Removes page P, which must already be unmapped, from frame F.
+   Frees F if P was its last page.  The frame table lock must be
+   held. */
+void
+frame_remove_page (struct frame *f, struct page *p)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  list_remove (&p->frame_elem);
+  if (list_empty (&f->pages))
+    frame_free (f);
+}
+
+/* Reserves PAGE_CNT frames of the user pool with palloc_reserve(),
+   evicting pages to make room if necessary.  At least
+   RESERVE_FLOOR frames are always left free or evictable.
+   Returns true if successful, false if there are not enough
+   frames.  The frame table lock must be held. */
+bool
+frame_reserve (size_t page_cnt)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  /* Reserving a frame takes it away from both the unreserved
+     free frames and the resident, evictable ones, so their sum
+     drops by PAGE_CNT however many pages get evicted.  Refuse
+     if that would leave too few frames for processes to fault
+     in their code, stacks, and other pages, which would get a
+     process killed on its next fault instead of seeing
+     sbrk() fail. */
+  if (page_cnt + RESERVE_FLOOR > palloc_available (PAL_USER) + frame_cnt)
+    return false;
+
+  while (!palloc_reserve (PAL_USER, page_cnt))
+    if (!evict ())
+      return false;
+  return true;
+}
+
+/* Chooses a frame to evict with the clock algorithm, evicts
+   every page it holds, and frees it.  Returns true if
+   successful, false if no frame could be evicted. */
+static bool
+evict (void)
+{
+  size_t i;
+
+  /* Two sweeps are enough: the first clears every accessed bit. */
+  for (i = 0; i < 2 * frame_cnt; i++)
+    {
+      struct frame *f;
+
+      if (hand == list_end (&frames))
+        hand = list_begin (&frames);
+      f = list_entry (hand, struct frame, elem);
+      hand = list_next (hand);
+
+      if (frame_accessed (f))
+        continue;
+
+      /* Only a private frame's page can fail to be evicted, when
+         swap is full, so this either evicts every page or none. */
+      while (!list_empty (&f->pages))
+        {
+          struct page *p = list_entry (list_front (&f->pages),
+                                       struct page, frame_elem);
+          if (!page_evict (p))
+            break;
+          list_pop_front (&f->pages);
+        }
+      if (list_empty (&f->pages))
+        {
+          frame_free (f);
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Returns true if any page held in frame F has been accessed
+   since the last call, clearing all of their accessed bits. */
+static bool
+frame_accessed (struct frame *f)
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      uint32_t *pd = p->thread->pagedir;
+      if (pagedir_is_accessed (pd, p->upage))
+        {
+          pagedir_set_accessed (pd, p->upage, false);
+          accessed = true;
+        }
+    }
+  return accessed;
+}
+
+/* Removes frame F, which holds no pages, from the frame table and
+   frees it. */
+static void
+frame_free (struct frame *f)
+{
+  ASSERT (list_empty (&f->pages));
+
+  if (hand == &f->elem)
+    hand = list_next (hand);
+  list_remove (&f->elem);
+  if (f->inode != NULL)
+    hash_delete (&shared_frames, &f->hash_elem);
+  frame_cnt--;
+  palloc_free_page (f->kpage);
+  free (f);
+}
+
+/* Returns a hash value for the shared frame whose hash element
+   is E. */
+static unsigned
+frame_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, hash_elem);
+  return hash_bytes (&f->inode, sizeof f->inode) ^ hash_int (f->ofs);
+}
+
+/* Returns true if shared frame A precedes shared frame B. */
+static bool
+frame_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, hash_elem);
+  const struct frame *b = hash_entry (b_, struct frame, hash_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  else if (a->ofs != b->ofs)
+    return a->ofs < b->ofs;
+  else
+    return a->read_bytes < b->read_bytes;
+}
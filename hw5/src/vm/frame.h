@@ -0,0 +1,44 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+#include "threads/palloc.h"
+
+struct inode;
+struct page;
+
+/* A frame of the user pool holding a user page.
+
+   Usually a frame holds one page of one process.  A shared frame
+   holds a read-only page of an executable, identified by INODE,
+   OFS, and READ_BYTES, and may be mapped by any number of
+   processes running that executable. */
+struct frame
+  {
+    void *kpage;                /* Kernel virtual address. */
+    struct list pages;          /* Pages held in this frame. */
+    struct list_elem elem;      /* Element in the frame table. */
+
+    /* Shared frames only. */
+    struct inode *inode;        /* Executable, or null if private. */
+    off_t ofs;                  /* Offset in INODE. */
+    size_t read_bytes;          /* Bytes read from INODE. */
+    struct hash_elem hash_elem; /* Element in the shared frame table. */
+  };
+
+void frame_init (void);
+void frame_acquire (void);
+void frame_release (void);
+struct frame *frame_alloc (struct page *, enum palloc_flags);
+struct frame *frame_share (struct page *, struct inode *, off_t,
+                           size_t read_bytes);
+void frame_make_shared (struct frame *, struct inode *, off_t,
+                        size_t read_bytes);
+void frame_remove_page (struct frame *, struct page *);
+bool frame_reserve (size_t page_cnt);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,123 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <list.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/page.h"
+
+/* Memory-mapped files.
+
+   A mapping adds one page-file page per page of the file to the
+   supplemental page table, marked for write-back.  Nothing is
+   read until the process touches a page, and dirty pages are
+   written back to the file when they are evicted or when the
+   mapping goes away.  Each mapping holds its own reopened file,
+   so it survives the process closing the descriptor. */
+
+/* A memory mapping. */
+struct mapping
+  {
+    struct list_elem elem;      /* Element in thread's `mappings'. */
+    mapid_t id;                 /* Mapping identifier. */
+    struct file *file;          /* File mapped. */
+    uint8_t *base;              /* Start of mapping. */
+    size_t page_cnt;            /* Number of pages mapped. */
+  };
+
+static void unmap (struct mapping *);
+
+/* Maps FILE into the current process's address space at ADDR and
+   returns the new mapping's identifier.  Returns MAP_FAILED if
+   ADDR is not page-aligned, if FILE is empty, if the mapping
+   would overlap any page already in use, or if memory is short. */
+mapid_t
+mmap_map (struct file *file, void *addr)
+{
+  struct thread *t = thread_current ();
+  struct mapping *m;
+  off_t length = file_length (file);
+  size_t i;
+
+  if (addr == NULL || pg_ofs (addr) != 0 || length == 0
+      || !is_user_vaddr ((uint8_t *) addr + length)
+      || (uint8_t *) addr + length < (uint8_t *) addr)
+    return MAP_FAILED;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return MAP_FAILED;
+  m->file = file_reopen (file);
+  if (m->file == NULL)
+    {
+      free (m);
+      return MAP_FAILED;
+    }
+  m->id = t->next_mapid++;
+  m->base = addr;
+  m->page_cnt = 0;
+
+  for (i = 0; (off_t) (i * PGSIZE) < length; i++)
+    {
+      off_t ofs = i * PGSIZE;
+      size_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+      if (page_add_file (m->base + ofs, m->file, ofs, read_bytes,
+                         true, true) == NULL)
+        {
+          unmap (m);
+          return MAP_FAILED;
+        }
+      m->page_cnt++;
+    }
+  list_push_back (&t->mappings, &m->elem);
+  return m->id;
+}
+
+/* Removes the current process's mapping ID, writing back any
+   pages that were changed.  Returns true if successful, false if
+   there is no such mapping. */
+bool
+mmap_unmap (mapid_t id)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&t->mappings); e != list_end (&t->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->id == id)
+        {
+          list_remove (&m->elem);
+          unmap (m);
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Removes all of the current process's mappings, writing back
+   any pages that were changed. */
+void
+mmap_destroy (void)
+{
+  struct thread *t = thread_current ();
+
+  while (!list_empty (&t->mappings))
+    unmap (list_entry (list_pop_front (&t->mappings),
+                       struct mapping, elem));
+}
+
+/* Removes the pages of mapping M, closes its file, and frees
+   it.  M must not be in a list. */
+static void
+unmap (struct mapping *m)
+{
+  size_t i;
+
+  for (i = 0; i < m->page_cnt; i++)
+    page_remove (m->base + i * PGSIZE);
+  file_close (m->file);
+  free (m);
+}
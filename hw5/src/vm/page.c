@@ -0,0 +1,434 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+/* Supplemental page table.
+
+   Each process keeps a hash table, keyed by user virtual page,
+   that describes every page of its address space: where its
+   contents come from and, if it is resident, which frame holds
+   it.  The hardware page directory only ever maps resident
+   pages.  A page that is not resident is mapped by page_load()
+   when the process first touches it, which lets executables,
+   the heap, and the stack be set up without allocating or
+   reading anything up front.
+
+   The table's structure belongs to its process and is only
+   changed by that process's thread.  The residency of its pages
+   may also be changed by another process evicting them, so that
+   is protected by the frame table lock (see frame.c). */
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func destroy_page;
+static struct page *add_page (void *upage, enum page_type, bool writable);
+static void write_back (struct page *);
+static bool is_shareable (const struct page *);
+static bool load_page (struct page *);
+static bool map_page (struct page *, struct frame *);
+static void fault_around (struct page *);
+
+/* Largest number of pages fault_around() maps in one fault. */
+#define FAULT_AROUND_MAX 16
+
+/* Fault-around statistics. */
+static long long fault_around_cnt;  /* Pages mapped ahead of a fault. */
+static unsigned fault_around_peak;  /* Largest window used. */
+
+/* Pages read from a file or swap by load_page(). */
+static long long page_in_cnt;
+
+/* Initializes the current process's supplemental page table.
+   Returns true if successful, false on memory allocation
+   failure. */
+bool
+page_table_init (void)
+{
+  return hash_init (&thread_current ()->pages, page_hash, page_less, NULL);
+}
+
+/* Frees every page in the current process's supplemental page
+   table, unmapping it from the page directory, and then the
+   table itself.  Must be called while the page directory still
+   exists. */
+void
+page_table_destroy (void)
+{
+  frame_acquire ();
+  hash_destroy (&thread_current ()->pages, destroy_page);
+  frame_release ();
+}
+
+/* Returns the current process's page that contains UPAGE, or a
+   null pointer if UPAGE is not part of its address space. */
+struct page *
+page_lookup (const void *upage)
+{
+  struct page p;
+  struct hash_elem *e;
+
+  p.upage = pg_round_down (upage);
+  e = hash_find (&thread_current ()->pages, &p.hash_elem);
+  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/* Adds a page at UPAGE to the current process that reads as
+   zeros when first touched.  If RESERVED is true, its frame has
+   already been set aside with palloc_reserve(), so loading it
+   cannot run out of memory.  Returns the new page, or a null
+   pointer if UPAGE is already in use or memory is short. */
+struct page *
+page_add_zero (void *upage, bool writable, bool reserved)
+{
+  struct page *p = add_page (upage, PAGE_ZERO, writable);
+  if (p != NULL)
+    p->reserved = reserved;
+  return p;
+}
+
+/* Adds a page at UPAGE to the current process whose first
+   READ_BYTES bytes are read from FILE at offset OFS, and whose
+   remaining bytes are zeros, when it is first touched.  FILE
+   must stay open for as long as the page exists.  If WRITE_BACK
+   is true, as for a memory-mapped file, changes to the page are
+   written back to FILE when it is evicted or removed; otherwise
+   they go to swap.  Returns the new page, or a null pointer if
+   UPAGE is already in use or memory is short. */
+struct page *
+page_add_file (void *upage, struct file *file, off_t ofs,
+               size_t read_bytes, bool writable, bool write_back)
+{
+  struct page *p;
+
+  ASSERT (read_bytes <= PGSIZE);
+
+  p = add_page (upage, PAGE_FILE, writable);
+  if (p != NULL)
+    {
+      p->file = file;
+      p->ofs = ofs;
+      p->read_bytes = read_bytes;
+      p->write_back = write_back;
+    }
+  return p;
+}
+
+/* Brings the current process's page containing ADDR into memory
+   and maps it, evicting another page if necessary.  If this
+   fault continues a run of faults on consecutive pages, also maps
+   some of the pages that follow (see fault_around()).  Returns
+   true if successful, false if ADDR is not part of the address
+   space, is already resident, or the page could not be loaded.
+   Counts the fault in the current process's statistics. */
+bool
+page_load (const void *addr)
+{
+  struct page *p = page_lookup (addr);
+  long long page_ins;
+  bool success;
+
+  if (p == NULL)
+    return false;
+
+  frame_acquire ();
+  page_ins = page_in_cnt;
+  success = load_page (p);
+  if (success)
+    {
+      struct thread *t = thread_current ();
+      if (page_in_cnt == page_ins)
+        t->minor_faults++;
+      else
+        t->major_faults++;
+      fault_around (p);
+    }
+  frame_release ();
+  return success;
+}
+
+/* Prints fault-around statistics. */
+void
+page_print_stats (void)
+{
+  printf ("Fault-around: %lld pages mapped ahead, window up to %u pages\n",
+          fault_around_cnt, fault_around_peak);
+}
+
+/* Maps page P, unless it is already resident, evicting another
+   page if necessary.  Returns true if successful, false if P is
+   already resident or could not be loaded.  The frame table lock
+   must be held. */
+static bool
+load_page (struct page *p)
+{
+  enum palloc_flags flags = 0;
+  struct frame *f;
+
+  if (p->frame != NULL)
+    return false;
+
+  /* Another process may already have this part of the same
+     executable in memory. */
+  if (is_shareable (p))
+    {
+      f = frame_share (p, file_get_inode (p->file), p->ofs, p->read_bytes);
+      if (f != NULL)
+        {
+          if (!map_page (p, f))
+            return false;
+          goto done;
+        }
+    }
+
+  if (p->type == PAGE_ZERO)
+    flags |= PAL_ZERO;
+  if (p->reserved)
+    flags |= PAL_RESERVED;
+  f = frame_alloc (p, flags);
+  if (f == NULL)
+    return false;
+  p->reserved = false;
+
+  /* Map the frame before filling it, so that if there is no
+     memory for a page table, the page's contents are still
+     intact, even if they are only in swap. */
+  if (!map_page (p, f))
+    return false;
+
+  if (p->type == PAGE_FILE)
+    {
+      uint8_t *kpage = f->kpage;
+      if (file_read_at (p->file, kpage, p->read_bytes, p->ofs)
+          != (off_t) p->read_bytes)
+        {
+          pagedir_clear_page (thread_current ()->pagedir, p->upage);
+          frame_remove_page (f, p);
+          return false;
+        }
+      page_in_cnt++;
+      memset (kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+      if (is_shareable (p))
+        frame_make_shared (f, file_get_inode (p->file), p->ofs,
+                           p->read_bytes);
+    }
+  else if (p->type == PAGE_SWAP)
+    {
+      swap_in (p->swap_slot, f->kpage);
+      p->swap_slot = SWAP_NONE;
+      page_in_cnt++;
+    }
+
+ done:
+  p->frame = f;
+  if (++p->thread->resident_cnt > p->thread->resident_peak)
+    p->thread->resident_peak = p->thread->resident_cnt;
+  return true;
+}
+
+/* Maps page P to frame F, which already lists P, in the current
+   process's page directory.  On failure, which happens only if
+   there is no memory for a page table, removes P from F and
+   returns false. */
+static bool
+map_page (struct page *p, struct frame *f)
+{
+  if (pagedir_set_page (thread_current ()->pagedir, p->upage, f->kpage,
+                        p->writable))
+    return true;
+  frame_remove_page (f, p);
+  return false;
+}
+
+/* Called after the current process faulted in page P.  If P
+   directly follows the page of the previous fault, the process is
+   probably scanning memory sequentially, so this maps up to the
+   next `fault_window' pages too, as long as they are of the same
+   kind as P and free frames are available.  The window doubles on
+   each consecutive sequential fault, up to FAULT_AROUND_MAX, and
+   closes again on the first fault that is not sequential.  The
+   frame table lock must be held. */
+static void
+fault_around (struct page *p)
+{
+  struct thread *t = thread_current ();
+  uint8_t *upage = p->upage;
+  unsigned i;
+
+  if (upage == t->last_fault + PGSIZE)
+    {
+      t->fault_window = t->fault_window == 0 ? 1 : t->fault_window * 2;
+      if (t->fault_window > FAULT_AROUND_MAX)
+        t->fault_window = FAULT_AROUND_MAX;
+    }
+  else
+    t->fault_window = 0;
+  if (t->fault_window > fault_around_peak)
+    fault_around_peak = t->fault_window;
+
+  for (i = 0; i < t->fault_window; i++)
+    {
+      struct page *next = page_lookup (upage + PGSIZE);
+
+      /* Don't evict anything to make room for a guess. */
+      if (next == NULL || next->type != p->type
+          || (p->type == PAGE_FILE && next->file != p->file)
+          || (!next->reserved && palloc_available (PAL_USER) == 0)
+          || !load_page (next))
+        break;
+      upage += PGSIZE;
+      fault_around_cnt++;
+    }
+  t->last_fault = upage;
+}
+
+/* Evicts page P, which is resident, unmapping it from its
+   process and writing it back to its file or to swap if it
+   cannot be rebuilt otherwise.  The caller removes P from its
+   frame.  Returns true if successful, false if the page must go
+   to swap and swap is full.  The frame table lock must be
+   held. */
+bool
+page_evict (struct page *p)
+{
+  uint32_t *pd = p->thread->pagedir;
+  bool dirty;
+
+  ASSERT (p->frame != NULL);
+
+  /* Unmap the page first, so that its owner cannot modify it
+     behind our back, then see whether it was modified. */
+  pagedir_clear_page (pd, p->upage);
+  dirty = pagedir_is_dirty (pd, p->upage) || p->type == PAGE_SWAP;
+  if (dirty && p->type == PAGE_FILE && p->write_back)
+    write_back (p);
+  else if (dirty)
+    {
+      size_t slot = swap_out (p->frame->kpage);
+      if (slot == SWAP_NONE)
+        {
+          /* Swap is full.  Map the page back, and remember that
+             it is dirty. */
+          bool success = pagedir_set_page (pd, p->upage, p->frame->kpage,
+                                           p->writable);
+          ASSERT (success);
+          pagedir_set_dirty (pd, p->upage, true);
+          return false;
+        }
+      p->type = PAGE_SWAP;
+      p->swap_slot = slot;
+    }
+  p->frame = NULL;
+  p->thread->resident_cnt--;
+  return true;
+}
+
+/* Removes the current process's page at UPAGE, if any, freeing
+   its frame or its reservation. */
+void
+page_remove (void *upage)
+{
+  struct page *p = page_lookup (upage);
+  if (p != NULL)
+    {
+      hash_delete (&thread_current ()->pages, &p->hash_elem);
+      frame_acquire ();
+      destroy_page (&p->hash_elem, NULL);
+      frame_release ();
+    }
+}
+
+/* Creates a page of the given TYPE at UPAGE and adds it to the
+   current process's table.  Returns the new page, or a null
+   pointer if UPAGE is already in use or memory is short. */
+static struct page *
+add_page (void *upage, enum page_type type, bool writable)
+{
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  p = calloc (1, sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->thread = thread_current ();
+  p->upage = upage;
+  p->type = type;
+  p->writable = writable;
+  p->swap_slot = SWAP_NONE;
+  if (hash_insert (&thread_current ()->pages, &p->hash_elem) != NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  return p;
+}
+
+/* Returns true if page P may share a frame with the same page of
+   other processes, that is, if it is a read-only page of an
+   executable. */
+static bool
+is_shareable (const struct page *p)
+{
+  return p->type == PAGE_FILE && !p->writable && !p->write_back;
+}
+
+/* Writes resident page P back to its file. */
+static void
+write_back (struct page *p)
+{
+  file_write_at (p->file, p->frame->kpage, p->read_bytes, p->ofs);
+}
+
+/* Frees the page whose hash element is E, along with its frame,
+   its reservation, or its swap slot.  The frame table lock must
+   be held. */
+static void
+destroy_page (struct hash_elem *e, void *aux UNUSED)
+{
+  struct page *p = hash_entry (e, struct page, hash_elem);
+
+  if (p->frame != NULL)
+    {
+      uint32_t *pd = thread_current ()->pagedir;
+      pagedir_clear_page (pd, p->upage);
+      if (p->type == PAGE_FILE && p->write_back
+          && pagedir_is_dirty (pd, p->upage))
+        write_back (p);
+      frame_remove_page (p->frame, p);
+      p->thread->resident_cnt--;
+    }
+  else if (p->reserved)
+    palloc_unreserve (PAL_USER, 1);
+  else if (p->type == PAGE_SWAP)
+    swap_free (p->swap_slot);
+  free (p);
+}
+
+/* Returns a hash value for the page whose hash element is E. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return hash_int ((int) pg_no (p->upage));
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+
+  return a->upage < b->upage;
+}
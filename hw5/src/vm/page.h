@@ -0,0 +1,61 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+/* Where a page's contents come from when it is not resident. */
+enum page_type
+  {
+    PAGE_ZERO,                  /* All zeros. */
+    PAGE_FILE,                  /* Read from a file, rest zeros. */
+    PAGE_SWAP                   /* Read from swap. */
+  };
+
+/* A user page in the supplemental page table.
+
+   Every page of a process's address space has one of these,
+   whether or not it is currently mapped in the process's page
+   directory.  A page is resident if FRAME is nonnull; otherwise
+   it is brought in by page_load() on its next access.  A page
+   that has been modified becomes a PAGE_SWAP page the first time
+   it is evicted, since it can no longer be rebuilt from its
+   original source.  FRAME, TYPE, and SWAP_SLOT are protected by
+   the frame table lock. */
+struct page
+  {
+    struct hash_elem hash_elem; /* Element in thread's `pages'. */
+    struct thread *thread;      /* Owning process. */
+    void *upage;                /* User virtual address. */
+    struct frame *frame;        /* Frame, or null if not resident. */
+    struct list_elem frame_elem; /* Element in FRAME's `pages'. */
+    enum page_type type;        /* Source of contents. */
+    bool writable;              /* Writable by the user process? */
+    bool reserved;              /* Frame reserved with palloc_reserve()? */
+
+    /* PAGE_FILE only. */
+    struct file *file;          /* File to read. */
+    off_t ofs;                  /* Offset in FILE. */
+    size_t read_bytes;          /* Bytes to read; the rest are zeroed. */
+    bool write_back;            /* Write changes back to FILE? */
+
+    /* PAGE_SWAP only. */
+    size_t swap_slot;           /* Swap slot, SWAP_NONE if resident. */
+  };
+
+bool page_table_init (void);
+void page_table_destroy (void);
+
+struct page *page_lookup (const void *upage);
+struct page *page_add_zero (void *upage, bool writable, bool reserved);
+struct page *page_add_file (void *upage, struct file *, off_t,
+                            size_t read_bytes, bool writable,
+                            bool write_back);
+bool page_load (const void *addr);
+void page_print_stats (void);
+bool page_evict (struct page *);
+void page_remove (void *upage);
+
+#endif /* vm/page.h */
@@ -0,0 +1,91 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "threads/vaddr.h"
+
+/* Swap partition.
+
+   The swap device is divided into page-size slots.  A bitmap
+   records which slots are in use.  The swap code is only called
+   with the frame table lock held (see frame.c), which serializes
+   all access to the bitmap. */
+
+/* Number of sectors per page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block *swap_device;   /* Swap device, or null if none. */
+static struct bitmap *used_slots;   /* Slots in use, one bit per slot. */
+static size_t free_cnt;             /* Number of free slots. */
+
+/* Initializes the swap partition.  Without a swap device, pages
+   can still be evicted if they can be reloaded from where they
+   came from, but nothing can be swapped out. */
+void
+swap_init (void)
+{
+  size_t slot_cnt;
+
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    {
+      printf ("swap: no swap device\n");
+      return;
+    }
+
+  slot_cnt = block_size (swap_device) / SECTORS_PER_PAGE;
+  used_slots = bitmap_create (slot_cnt);
+  if (used_slots == NULL)
+    PANIC ("bitmap creation failed--swap device is too large");
+  free_cnt = slot_cnt;
+  printf ("swap: %zu slots on %s\n", slot_cnt, block_name (swap_device));
+}
+
+/* Returns the number of free swap slots. */
+size_t
+swap_free_cnt (void)
+{
+  return free_cnt;
+}
+
+/* Writes the page at KPAGE to a free swap slot and returns the
+   slot, or SWAP_NONE if there are no free slots. */
+size_t
+swap_out (const void *kpage)
+{
+  size_t slot;
+  size_t i;
+
+  if (free_cnt == 0)
+    return SWAP_NONE;
+  slot = bitmap_scan_and_flip (used_slots, 0, 1, false);
+  ASSERT (slot != BITMAP_ERROR);
+  free_cnt--;
+
+  for (i = 0; i < SECTORS_PER_PAGE; i++)
+    block_write (swap_device, slot * SECTORS_PER_PAGE + i,
+                 (const uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  return slot;
+}
+
+/* Reads the page in SLOT into KPAGE and frees SLOT. */
+void
+swap_in (size_t slot, void *kpage)
+{
+  size_t i;
+
+  for (i = 0; i < SECTORS_PER_PAGE; i++)
+    block_read (swap_device, slot * SECTORS_PER_PAGE + i,
+                (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  swap_free (slot);
+}
+
+/* Frees SLOT without reading it. */
+void
+swap_free (size_t slot)
+{
+  ASSERT (bitmap_test (used_slots, slot));
+  bitmap_reset (used_slots, slot);
+  free_cnt++;
+}
@@ -0,0 +1,15 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stddef.h>
+
+/* Swap slot index that names no slot. */
+#define SWAP_NONE ((size_t) -1)
+
+void swap_init (void);
+size_t swap_free_cnt (void);
+size_t swap_out (const void *kpage);
+void swap_in (size_t slot, void *kpage);
+void swap_free (size_t slot);
+
+#endif /* vm/swap.h */